@@ -0,0 +1,120 @@
+#include "../inc/config_file/ConfigFileParsing.hpp"
+#include "../inc/configuration_key/RoutingTable.hpp"
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+/**
+ * Microbenchmark of the location matching of a request.
+ * Builds server blocks with a growing amount of prefix, exact and regex locations, parses them like the
+ * webserver does and measures matchLocation against request paths hitting every kind of location.
+ * The linear column is the scan over all locations the server used before the radix tree.
+ * USAGE: make bench && ./location_bench [rounds]
+ */
+
+#define REQUEST_PATHS 1024
+
+static double	now()
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Server block with the prefix locations /app<i>/ (every fourth one level deeper),
+ * an exact location for every tenth prefix and caseless regex locations for file endings
+ */
+static std::string	build_server_block(int port, int prefixes, int regexes)
+{
+	std::ostringstream	conf;
+
+	conf << "server {\n\tlisten " << port << "\n\tserver_name bench" << port << ".local\n\troot ./resources\n\tindex index.html\n";
+	for (int i = 0; i < prefixes; i++)
+	{
+		conf << "\tlocation /app" << i << (i % 4 == 3 ? "/static" : "") << " {\n\t\troot ./resources/app\n\t\tindex index.html\n\t}\n";
+		if (i % 10 == 0)
+			conf << "\tlocation = /app" << i << "/status {\n\t\troot ./resources/app\n\t}\n";
+	}
+	for (int i = 0; i < regexes; i++)
+		conf << "\tlocation ~* \\.ext" << i << "$ {\n\t\troot ./resources/app\n\t}\n";
+	conf << "}\n";
+	return conf.str();
+}
+
+static std::vector<std::string>	build_paths(int prefixes, int regexes)
+{
+	std::vector<std::string>	paths;
+
+	srand(42);
+	for (int i = 0; i < REQUEST_PATHS; i++)
+	{
+		int				n = rand() % prefixes;
+		std::ostringstream	path;
+		switch (i % 4)
+		{
+			case 0: path << "/app" << n << (n % 4 == 3 ? "/static" : "") << "/css/style.css"; break; // longest prefix
+			case 1: path << "/app" << (n - n % 10) << "/status"; break; // exact
+			case 2: path << "/app" << n << "/upload/file.EXT" << (regexes ? rand() % regexes : 0); break; // regex
+			default: path << "/unknown" << n << "/index.html"; break; // no location
+		}
+		paths.push_back(path.str());
+	}
+	return paths;
+}
+
+/**
+ * @brief The old lookup: compare the request directory with every location of the server block
+ */
+static const ConfigurationKey	*linear_match(const std::vector<ConfigurationKey> &locations, const std::string &path)
+{
+	std::string	directory = path.substr(0, path.rfind('/') + 1);
+
+	for (size_t i = 0; i < locations.size(); i++)
+		if (!locations[i].value.compare(directory))
+			return &locations[i];
+	return NULL;
+}
+
+int	main(int argc, char **argv)
+{
+	int					rounds = argc > 1 ? atoi(argv[1]) : 200;
+	int					sizes[][2] = { {10, 0}, {100, 0}, {500, 0}, {1000, 0}, {100, 5}, {500, 10}, {1000, 20} };
+	size_t				count = sizeof(sizes) / sizeof(sizes[0]);
+	ConfigFileParsing	parser; // the parser can only run once per process, every size is a server block
+	std::string			conf;
+
+	for (size_t s = 0; s < count; s++)
+		conf += build_server_block(8080 + s, sizes[s][0], sizes[s][1]);
+	parser.parseConfigFile(conf);
+	std::cout << "locations  regexes    radix ns/match    linear ns/match    matched" << std::endl;
+	for (size_t s = 0; s < count; s++)
+	{
+		VirtualServer		server;
+		server.compile(parser.serverBlocks[s]);
+		std::vector<ConfigurationKey>	locations = parser.serverBlocks[s].getConfigurationKeysWithType(LOCATION);
+		std::vector<std::string>		paths = build_paths(sizes[s][0], sizes[s][1]);
+		size_t	matched = 0;
+		size_t	found = 0;
+		size_t	length;
+
+		double	start = now();
+		for (int r = 0; r < rounds; r++)
+			for (size_t i = 0; i < paths.size(); i++)
+				matched += server.matchLocation(paths[i], length) != NULL;
+		double	radix = (now() - start) * 1e9 / (rounds * paths.size());
+
+		start = now();
+		for (int r = 0; r < rounds; r++)
+			for (size_t i = 0; i < paths.size(); i++)
+				found += linear_match(locations, paths[i]) != NULL;
+		double	linear = (now() - start) * 1e9 / (rounds * paths.size());
+
+		std::cout << std::setw(9) << locations.size() << std::setw(9) << sizes[s][1] << std::setw(18) << std::fixed << std::setprecision(1)
+			<< radix << std::setw(19) << linear << std::setw(11) << matched / rounds << "/" << paths.size() << std::endl;
+	}
+	return 0;
+}
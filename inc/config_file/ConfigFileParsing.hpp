@@ -26,6 +26,9 @@ class ConfigFileParsing {
 		// The server block vector which will provide the servers and their configurations
 		std::vector<ServerBlock> serverBlocks;
 		std::vector<unsigned int> getAllServerPortsFromAllBlocks();
+		int getWorkerProcesses();
+		size_t getFileCacheSize();
+		int getFileCacheCheckInterval();
 	private:
 		bool isGeneralFaultyFile( std::string &file_content );
 		void determineConfigurationKeys( std::string &file_content );
@@ -39,6 +42,7 @@ class ConfigFileParsing {
 		bool isCurrentlyInLocationBlock;
 		bool isCurrentlyInServerBlock;
 		int server_bracket_counter; // if is zero, we are currently not in a server block and config keys are not allowed
+		int currentServerIndex; // server block the keys are added to, -1 before the first one
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef CONFIG_SNAPSHOT_HPP
+# define CONFIG_SNAPSHOT_HPP
+
+#include "../config_file/ConfigFileParsing.hpp"
+#include "RoutingTable.hpp"
+#include <vector>
+
+/**
+ * @brief Immutable reference counted configuration: the parsed server blocks, their routing table
+ * and the process wide settings, compiled once from a ConfigFileParsing.
+ *
+ * Copying a ConfigSnapshot only increments the counter. The listening server and every connection keep one,
+ * so a connection costs a pointer instead of a copy of the configuration, and a snapshot stays alive
+ * until the last connection using it is gone.
+ * Like SharedBuffer the counter is not atomic, the workers get their own copy with fork.
+ * A reload builds a new snapshot next to the old one, connections still using the old one keep it until they are done.
+ * USAGE: ConfigSnapshot config(parser, path); config.routes().resolve("example.com", 8080);
+ */
+class ConfigSnapshot
+{
+	public:
+		ConfigSnapshot();
+		ConfigSnapshot(ConfigFileParsing &configFile, const std::string &path);
+		ConfigSnapshot(const ConfigSnapshot &src);
+		ConfigSnapshot &operator=(const ConfigSnapshot &src);
+		~ConfigSnapshot();
+
+		static ConfigSnapshot			load(const std::string &path);
+
+		bool							empty() const;
+		const std::string				&path() const;
+		const std::vector<ServerBlock>	&serverBlocks() const;
+		const ServerBlock				&defaultServerBlock() const;
+		const RoutingTable				&routes() const;
+		const std::vector<unsigned int>	&ports() const;
+		size_t							fileCacheSize() const;
+		int								fileCacheCheckInterval() const;
+		int								workerProcesses() const;
+
+	private:
+		struct Block
+		{
+			std::string					path; // the configuration file, read again for a reload
+			std::vector<ServerBlock>	serverBlocks;
+			RoutingTable				routes;
+			std::vector<unsigned int>	ports; // every port of every server block, once
+			size_t						fileCacheSize;
+			int							fileCacheCheckInterval;
+			int							workerProcesses;
+			unsigned int				refs;
+		};
+
+		void	release();
+
+		Block	*_block;
+};
+
+#endif
@@ -7,6 +7,18 @@
 
 enum method {  GET, POST, DELETE, PUT, UNKNOWN };
 
+/**
+ * How the path of a location is compared with the request path, set by the modifier in front of the path.
+ * Without modifier the location matches every path starting with it, the longest match wins.
+ */
+enum locationMatch {
+	LOCATION_PREFIX,			// location /path/
+	LOCATION_EXACT,				// location = /path
+	LOCATION_PREFIX_NO_REGEX,	// location ^~ /path/, regex locations are not checked if it is the longest prefix
+	LOCATION_REGEX,				// location ~ pattern
+	LOCATION_REGEX_CASELESS		// location ~* pattern
+};
+
 /**
  * All keys which can be used in the configuration file are defined here.
  * To add a new key, add it to the KEY_DEFINES and to the enum.
@@ -24,12 +36,40 @@ enum method {  GET, POST, DELETE, PUT, UNKNOWN };
 # define	KEY_METHODS					"methods"
 # define	KEY_EXECUTABLE_PATH			"cgi_path"
 # define	KEY_FILEENDING				"cgi_fileending"
+# define	KEY_FASTCGI_PASS			"fastcgi_pass"
+# define	KEY_CGI_HELPERS				"cgi_helpers"
+# define	KEY_CGI_HELPER_REQUESTS		"cgi_helper_requests"
 # define	KEY_NOT_FOUND_PAGE			"not_found_error_page"
 # define	KEY_NOT_AVAILABLE_PAGE		"not_available_page"
 # define	KEY_GENERAL_ERROR_PAGE		"general_error_page"
 # define	KEY_POST_MAX_SIZE			"post_max_size"
 # define	KEY_REDIRECTION				"redirection"
 # define	KEY_DIRECTORY_LISTING		"directory_listing"
+# define	KEY_WORKER_PROCESSES		"worker_processes"
+# define	KEY_KEEPALIVE_TIMEOUT		"keepalive_timeout"
+# define	KEY_KEEPALIVE_REQUESTS		"keepalive_requests"
+# define	KEY_CLIENT_HEADER_TIMEOUT	"client_header_timeout"
+# define	KEY_CLIENT_BODY_TIMEOUT		"client_body_timeout"
+# define	KEY_SEND_TIMEOUT			"send_timeout"
+# define	KEY_FILE_CACHE_SIZE			"file_cache_size"
+# define	KEY_FILE_CACHE_CHECK_INTERVAL	"file_cache_check_interval"
+
+# define	MAXIMUM_WORKER_PROCESSES	64
+# define	DEFAULT_KEEPALIVE_TIMEOUT	5 // seconds an idle connection is kept open
+# define	MAXIMUM_KEEPALIVE_TIMEOUT	3600
+# define	DEFAULT_KEEPALIVE_REQUESTS	100 // requests served on one connection before it is closed
+# define	MAXIMUM_KEEPALIVE_REQUESTS	1000000
+# define	DEFAULT_CLIENT_HEADER_TIMEOUT	5 // seconds a client has to send the head of a request
+# define	DEFAULT_CLIENT_BODY_TIMEOUT	5 // seconds between two reads of a request body
+# define	DEFAULT_SEND_TIMEOUT		30 // seconds between two writes of a response
+# define	MAXIMUM_CONNECTION_TIMEOUT	3600
+# define	DEFAULT_FILE_CACHE_SIZE		32 // megabyte of static files kept in memory per worker
+# define	MAXIMUM_FILE_CACHE_SIZE		1000
+# define	DEFAULT_FILE_CACHE_CHECK_INTERVAL	1 // seconds a cached file is used without checking it on disk
+# define	MAXIMUM_FILE_CACHE_CHECK_INTERVAL	3600
+# define	MAXIMUM_CGI_HELPERS			64 // helper processes per cgi_path and worker
+# define	DEFAULT_CGI_HELPER_REQUESTS	1000 // scripts started by a helper before it is replaced
+# define	MAXIMUM_CGI_HELPER_REQUESTS	1000000
 
 /**
  * Defines the type of information a configuration key holds.
@@ -50,12 +90,23 @@ enum ConfigurationKeyType {
 	METHODS,
 	CGI_EXECUTABLE_PATH,
 	CGI_FILEENDING,
+	FASTCGI_PASS,
+	CGI_HELPERS,
+	CGI_HELPER_REQUESTS,
 	POST_MAX_SIZE,
 	NOT_FOUND_ERROR_PAGE,
 	GENERAL_ERROR_PAGE,
 	REDIRECTION,
 	DIRECTORY_LISTING,
-	NOT_AVAILABLE_PAGE
+	NOT_AVAILABLE_PAGE,
+	WORKER_PROCESSES,
+	KEEPALIVE_TIMEOUT,
+	KEEPALIVE_REQUESTS,
+	CLIENT_HEADER_TIMEOUT,
+	CLIENT_BODY_TIMEOUT,
+	SEND_TIMEOUT,
+	FILE_CACHE_SIZE,
+	FILE_CACHE_CHECK_INTERVAL
 };
 
 /**
@@ -113,14 +164,27 @@ class ConfigurationKey {
 		std::vector <method> allowedMethods; // allowedMethods, contains all the enums of the allowed methds
 		std::string root; // returns the path of the root
 		std::string location; // returns the locationpath of the location
+		locationMatch location_match; // modifier of a location key, the path (or pattern) is the value
 		std::string cgi_path; // returns the locationpath of the location
 		std::string cgi_fileending; // those file endings should be executed with a cgi
+		std::string fastcgi_pass; // FastCGI server (unix:/path or ip:port) running the cgi files instead of cgi_path
+		int cgi_helpers_min; // helper processes started for cgi_path when the worker starts
+		int cgi_helpers_max; // helper processes cgi_path may use under load, 0 forks the scripts from the worker
+		int cgi_helper_requests; // scripts a helper process starts before it is replaced
 		std::string redirection; // a redirection which is set in the configuration file for a certain location
 		std::string not_found_error_page_path; // returns the location of the error path to the error file
 		std::string general_error_page_path; // returns the location of the error path to the error file
 		std::string not_available_page_path; // returns the location of the error path to the error file
 		bool directory_listing; // flag if directory listing is enabled or not
 		int post_max_size; // post max size in megabyte
+		int worker_processes; // number of worker processes, each with its own event loop and listening sockets
+		int keepalive_timeout; // seconds an idle persistent connection is kept open, 0 disables keep-alive
+		int keepalive_requests; // maximum amount of requests served on one persistent connection
+		int client_header_timeout; // seconds a client has to send the head of a request
+		int client_body_timeout; // seconds a client may pause while it sends a request body
+		int send_timeout; // seconds a client may stop taking the response before it is disconnected
+		int file_cache_size; // megabyte of static files kept in memory, 0 disables the cache
+		int file_cache_check_interval; // seconds a cached file is served without checking it on disk
 		std::vector <unsigned int> ports; // returns the ports which are being listened to by the listener handler
 		std::vector<ConfigurationKeyType> nestedConfigurationKeyTypesinLocationBlock; // describes the properties within the location block
 	private:
@@ -136,11 +200,23 @@ class ConfigurationKey {
 		bool isMethodsKeyType(internal_keyvalue raw);
 		bool isCgiExecutableKeyType(internal_keyvalue raw);
 		bool isCgiFileEndingKeyType(internal_keyvalue raw);
+		bool isFastCgiPassKeyType(internal_keyvalue raw);
+		bool isCgiHelpersKeyType(internal_keyvalue raw);
+		bool isCgiHelperRequestsKeyType(internal_keyvalue raw);
 		bool isNotFoundErrorPagePathType(internal_keyvalue raw);
 		bool isPostMaxSizeType(internal_keyvalue raw);
 		bool isGeneralErrorPagePathType(internal_keyvalue raw);
 		bool isNotAvailableErrorPagePathType(internal_keyvalue raw);
 		bool isRedirectionKeyType(internal_keyvalue raw);
+		bool isWorkerProcessesKeyType(internal_keyvalue raw);
+		bool isKeepAliveTimeoutKeyType(internal_keyvalue raw);
+		bool isKeepAliveRequestsKeyType(internal_keyvalue raw);
+		bool isClientHeaderTimeoutKeyType(internal_keyvalue raw);
+		bool isClientBodyTimeoutKeyType(internal_keyvalue raw);
+		bool isSendTimeoutKeyType(internal_keyvalue raw);
+		bool isFileCacheSizeKeyType(internal_keyvalue raw);
+		bool isFileCacheCheckIntervalKeyType(internal_keyvalue raw);
+		bool validateNumberInRange(std::string to_validate, int min, int max);
 		bool isValidMethod(std::string method);
 		bool validatePort(unsigned int port);
 		bool is_digits(const std::string &str);
@@ -148,6 +224,7 @@ class ConfigurationKey {
 		bool validateCgiFileEnding(std::string to_validate);
 		bool validatePostMaxSize(std::string to_validate);
 		bool validateRedirection(std::string value);
+		bool validateLocationPattern(std::string pattern, bool caseless);
 		void addMethodToMethodEnum(std::string methodToAdd);
 		bool isDirectoryListingConfigurationKeyType(internal_keyvalue raw);
 		
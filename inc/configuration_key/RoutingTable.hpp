@@ -0,0 +1,127 @@
+#ifndef ROUTING_TABLE_HPP
+# define ROUTING_TABLE_HPP
+
+#include "ServerBlock.hpp"
+#include <regex.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A location block with everything a request needs from it, resolved once when the table is compiled.
+ */
+struct RouteLocation
+{
+	std::string			path; // the location as written in the configuration file (the pattern of a regex location)
+	locationMatch		match;
+	std::string			root;
+	std::string			index; // first index of the location, empty if it has none
+	std::string			cgi_path;
+	std::string			cgi_fileending;
+	std::string			fastcgi_pass;
+	std::string			redirection;
+	std::vector<method>	methods;
+	bool				directory_listing;
+};
+
+/**
+ * @brief A server block and its locations, compiled for the lookups of a request.
+ *
+ * The values Process and ClientSocket need on every request are resolved once. Prefix and exact locations
+ * are kept in a radix tree over the characters of their path, regex locations are compiled with regcomp.
+ * A request is matched like nginx does it:
+ *  1. an exact location (=) equal to the path wins right away
+ *  2. the longest prefix location is remembered, if it is a ^~ location it wins
+ *  3. the regex locations are tried in the order of the configuration file, the first match wins
+ *     (one automaton of all patterns rejects most requests before the patterns are tried one by one)
+ *  4. otherwise the longest prefix location wins
+ * A lookup walks the tree once along the request path, it neither copies configuration keys nor allocates.
+ */
+class VirtualServer
+{
+	public:
+		VirtualServer();
+		VirtualServer(const VirtualServer &src);
+		VirtualServer &operator=(const VirtualServer &rhs);
+		~VirtualServer();
+
+		void					compile(const ServerBlock &block);
+		const RouteLocation		*matchLocation(const std::string &path, size_t &matched) const;
+
+		ServerBlock		block; // the parsed server block, for the error pages
+		std::string		root;
+		std::string		index; // first index of the server block
+		std::string		server_name; // first server name, empty if there is none
+		std::string		cgi_path;
+		std::string		cgi_fileending;
+		bool			has_post_max_size;
+		unsigned long	post_max_size; // bytes, ULONG_MAX without post_max_size
+		int				keepalive_timeout;
+		int				keepalive_requests;
+		int				client_header_timeout; // seconds
+		int				client_body_timeout;
+		int				send_timeout;
+
+	private:
+		struct Node
+		{
+			std::string							label; // characters of the edge from the parent to this node
+			std::vector<std::pair<char, int> >	children; // first character of the label -> node, sorted by character
+			int									prefix; // index in _locations of the prefix location ending here, -1 otherwise
+			int									exact; // index in _locations of the exact location ending here, -1 otherwise
+		};
+
+		int		newNode(const std::string &label);
+		int		child(int node, char c) const;
+		void	link(int node, int next);
+		void	insert(const std::string &path, int location, bool exact);
+		void	compilePatterns();
+		void	freePatterns();
+
+		std::vector<RouteLocation>	_locations;
+		std::vector<Node>			_nodes; // _nodes[0] is the root of the tree, its label is empty
+		std::vector<int>			_patterns; // regex locations in the order of the configuration file
+		std::vector<regex_t>		_compiled; // compiled _patterns, recompiled for every copy
+		regex_t						_any; // all patterns as one caseless alternation, a request not matching it skips the loop
+		bool						_has_any;
+};
+
+/**
+ * @brief The parsed configuration compiled once at startup: (port, host) -> virtual server.
+ *
+ * A request names its server with the Host header and arrives on a port. Every server name of a
+ * server block listening on the port is an entry of an open addressing hash table (FNV-1a over host and port).
+ * Like before, the first server block declaring a name owns it and a name owned by a block which does not
+ * listen on the port (or an unknown name) is served by the first server block.
+ * The table is built before the first connection and never changes afterwards, clients only keep a reference.
+ * USAGE: const VirtualServer &server = routes.resolve("example.com", 8080);
+ */
+class RoutingTable
+{
+	public:
+		RoutingTable();
+		~RoutingTable();
+
+		void					compile(const std::vector<ServerBlock> &serverBlocks);
+		const VirtualServer		&resolve(const std::string &host, unsigned int port) const;
+		const VirtualServer		&defaultServer() const;
+
+	private:
+		RoutingTable(const RoutingTable &src);
+		RoutingTable &operator=(const RoutingTable &rhs);
+
+		struct Slot
+		{
+			unsigned int	hash;
+			unsigned int	port;
+			std::string		host;
+			int				server; // index in _servers, -1 if the slot is free
+		};
+
+		static unsigned int	hash(const std::string &host, unsigned int port);
+		void				insert(const std::string &host, unsigned int port, int server);
+
+		std::vector<VirtualServer>	_servers;
+		std::vector<Slot>			_slots; // size is a power of two, at most half of the slots are used
+};
+
+#endif
@@ -2,6 +2,9 @@
 # define SERVER_BLOCK
 
 #include "ConfigurationKey.hpp"
+#include "../http/SharedBuffer.hpp"
+#include <map>
+#include <climits>
 
 
 /**
@@ -13,6 +16,9 @@
  * Holds multiple configuration keys
  *
  * Also has functions to easily receive all ports and server names and indexes (ordered)
+ *
+ * The error responses (status line, headers and body) are rendered once after the configuration was parsed,
+ * an error is answered by queueing the shared buffer (once with connection keep-alive, once with close).
  */
 class ServerBlock
 {
@@ -27,11 +33,22 @@ class ServerBlock
 		std::vector<std::string> getAllIndexes();
 		std::string getCgiPath();
 		std::string getCgiFileEnding();
+		int getKeepAliveTimeout();
+		int getKeepAliveRequests();
+		int getClientHeaderTimeout();
+		int getClientBodyTimeout();
+		int getSendTimeout();
+		unsigned long getPostMaxSize();
 		void addConfigurationKey(ConfigurationKey &configurationKey);
-		std::vector<ConfigurationKey> getConfigurationKeysWithType(ConfigurationKeyType type);
-		std::string getErrorPagePathForCode(int statuscode);
-		std::string getFallbackErrorPageForCode(int statuscode);
+		std::vector<ConfigurationKey> getConfigurationKeysWithType(ConfigurationKeyType type) const;
+		std::string getErrorPagePathForCode(int statuscode) const;
+		std::string getFallbackErrorPageForCode(int statuscode) const;
+		void renderErrorPages();
+		SharedBuffer getErrorResponse(int statuscode, bool keep_alive) const;
 		int serverIndex;
+	private:
+		SharedBuffer renderErrorResponse(int statuscode, std::string status_text, bool keep_alive);
+		std::map<std::pair<int, bool>, SharedBuffer> _errorResponses; // [statuscode, keep alive] -> whole response
 };
 
  #endif
\ No newline at end of file
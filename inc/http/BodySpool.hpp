@@ -0,0 +1,44 @@
+#ifndef BODY_SPOOL_HPP
+# define BODY_SPOOL_HPP
+
+# include <string>
+# include <sys/types.h>
+
+# define BODY_MEMORY_LIMIT 65536 // request bodies up to this size stay in memory, bigger ones are spooled to a file
+# define BODY_SPOOL_TEMPLATE "/tmp/webserv_body_XXXXXX"
+
+/**
+ * @brief Reference counted temporary file holding a request body while it arrives.
+ * The file is unlinked right after it was created, it disappears with the last reference.
+ * Copying a BodySpool (the request gets copied into the queue, the process and the cgi) only increments the counter.
+ * The filedescriptor is close-on-exec, a cgi only gets the spool it reads as stdin.
+ */
+class BodySpool
+{
+	public:
+		BodySpool();
+		BodySpool(const BodySpool &src);
+		BodySpool &operator=(const BodySpool &src);
+		~BodySpool();
+
+		bool	open();
+		bool	append(const char *data, size_t size);
+
+		bool	isOpen() const;
+		int		fd() const;
+		size_t	size() const;
+
+	private:
+		struct Block
+		{
+			int				fd;
+			size_t			size;
+			unsigned int	refs;
+		};
+
+		void	release();
+
+		Block	*_block;
+};
+
+#endif
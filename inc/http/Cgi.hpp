@@ -17,11 +17,22 @@
 # include "../configuration_key/ServerBlock.hpp"
 # include <algorithm>
 # include "Request.hpp"
+# include "FastCgi.hpp"
+# include "CgiHelperPool.hpp"
+# include "SpawnBlock.hpp"
 
 extern char **environ;
 
+# define CGI_READ_SIZE 16384 // bytes read from the output pipe of the cgi at once
+# define CGI_HEADER_MAXIMUM_SIZE 16384 // the header fields of the cgi output have to end within these bytes
+# define CGI_INPUT_PIPE_SIZE 65536 // bodies up to the default buffer of a pipe are passed to the cgi through a pipe
+
 /**
  * @brief class that gets instantiated whenever a cgiscript is called
+ * The body of the request is the stdin of the script (pipe, memfd or the spooled body),
+ * its stdout is a non blocking pipe which is read by the event loop while the script runs.
+ * With fastcgi_pass the request goes to a FastCGI responder instead, _fd_out is the connection to it
+ * and the stdout stream it sends back is read the same way.
  */
 
 class	CGI
@@ -33,14 +44,15 @@ class	CGI
 		CGI	&operator=(const CGI &src);
 
 		//void	execute(void);
-		void		set_tmps(void);
-		void		write_in_std_in(void);
+		void		set_input(void);
 		void		set_environment(void);
 		void		execute_cgi(void);
-		void		read_in_buff(void);
-		static void	sig_handler(int signum);
-		std::string	get_buf(void);
-		void wait_for_child(pid_t worker_pid);
+		ssize_t		read_output(std::string &output);
+		void		finish(bool kill_script);
+		void		set_fastcgi_pass(const std::string &address);
+		bool		isFastCgi(void) const;
+		void		start_fastcgi(void);
+		int			send_fastcgi(void);
 		std::string	calculate_path_info(std::string path);
 		
 		std::string	get_query(std::string referer);
@@ -48,12 +60,9 @@ class	CGI
 		//int			_pipefd_in[2];
 		//int			_pipefd_out[2];
 		int			_fd_in;
-		int			_fd_out;
-		FILE	*_tmpout;
-		FILE	*_tmpin;
-
-		char	**_argvp;
-		char	**_envp;
+		int			_fd_out; // read end of the output pipe (connection with fastcgi_pass), -1 once the output was read completely
+		pid_t		_pid;
+		CgiTicket	_ticket; // script started by a helper of the CgiHelperPool (then _pid stays -1)
 
 		std::string location_dl; // location for directory listing
 
@@ -61,15 +70,13 @@ class	CGI
 		std::map<std::string, std::string>	_env;
 		std::vector<std::string>	_query_parameters;
 		std::vector<std::string>	_argv;
-		std::string	_buf;
-		// FILE	*_tmpout;
-		// FILE	*_tmpin;
 		//int		_fd;
-		int		_tmp_size;
 		Request	_request;
 		std::string	_server_name;
 		std::string	_path;
 		std::string	_cgi_path;
+		std::string	_fastcgi_pass; // address of the FastCGI responder, empty to run _cgi_path
+		FastCgiConnection	_fastcgi;
 };
 
 # endif
\ No newline at end of file
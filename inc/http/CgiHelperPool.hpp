@@ -0,0 +1,79 @@
+#ifndef CGI_HELPER_POOL_HPP
+# define CGI_HELPER_POOL_HPP
+
+# include <map>
+# include <string>
+# include <vector>
+# include <sys/types.h>
+# include "../debugger/Singleton.hpp"
+# include "../configuration_key/ServerBlock.hpp"
+# include "SpawnBlock.hpp"
+
+# define CGI_HELPER_SEND_TIMEOUT 1 // seconds the worker waits for a helper which does not read its messages
+
+/**
+ * @brief Identifies a script started by a helper: the connection to the helper and the number of the job.
+ * The helper knows the pid of the script, the worker does not need it.
+ */
+struct CgiTicket
+{
+	CgiTicket() : fd(-1), id(0) {}
+
+	int				fd;
+	unsigned int	id;
+};
+
+/**
+ * @brief Pre-forked helper processes which start the cgi scripts instead of the worker.
+ *
+ * Forking the worker copies its whole address space (caches, buffers, connections) for every script.
+ * When the worker starts, before it has any connection, it forks a small zygote process. The helpers are forked
+ * by the zygote and get their socket (socketpair) from the worker over SCM_RIGHTS, so they never hold a client connection.
+ * The worker sends a job (SpawnBlock, stdin and the write end of the output pipe) to a helper, the helper
+ * spawns the script and reaps it. Killing (timeout) and releasing a script are messages to its helper.
+ *
+ * Every cgi_path with cgi_helpers has its own pool: min helpers are started with the worker, more (up to max) are
+ * started while all helpers are still busy forking. A helper which started cgi_helper_requests scripts is replaced,
+ * it exits once its last script is done. Every worker has its own instance (Singleton).
+ */
+class CgiHelperPool : public Singleton<CgiHelperPool>
+{
+	public:
+		CgiHelperPool();
+		~CgiHelperPool();
+
+		void	start(const std::vector<ServerBlock> &serverBlocks, const std::vector<int> &inherited);
+		bool	has(const std::string &cgi_path) const;
+		bool	launch(const std::string &cgi_path, const SpawnBlock &job, int in, int out, CgiTicket &ticket);
+		void	terminate(const CgiTicket &ticket);
+		void	release(const CgiTicket &ticket);
+
+	private:
+		struct Helper
+		{
+			int				fd;
+			unsigned int	served; // scripts started
+			unsigned int	pending; // jobs which were not acknowledged yet
+			unsigned int	live; // tickets which were not terminated or released yet
+			bool			retiring; // served enough, closed once live is 0
+		};
+
+		struct Pool
+		{
+			std::vector<Helper>	helpers;
+			unsigned int		min;
+			unsigned int		max;
+			unsigned int		requests;
+		};
+
+		bool	spawnHelper(Pool &pool);
+		void	drainAcknowledgements(Pool &pool);
+		void	endTicket(const CgiTicket &ticket, unsigned int type);
+		void	closeHelper(Pool &pool, size_t index);
+
+		std::map<std::string, Pool>	_pools;
+		int							_zygote;
+		unsigned int				_next_id;
+};
+
+#endif
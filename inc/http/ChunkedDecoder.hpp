@@ -0,0 +1,64 @@
+#ifndef CHUNKED_DECODER_HPP
+# define CHUNKED_DECODER_HPP
+
+# include <string>
+
+# define CHUNK_LINE_MAXIMUM_SIZE 4096 // a longer chunk size line (size and extensions) is answered with 400
+# define CHUNK_SIZE_MAXIMUM_DIGITS 15 // more hex digits do not fit into the size, answered with 413
+# define CHUNK_TRAILER_MAXIMUM_SIZE 16384 // bigger trailer fields are answered with 431
+
+enum ChunkStatus {
+	CHUNK_NEED_MORE, // all bytes were framing, call decode() again once more bytes arrived
+	CHUNK_DATA, // body bytes follow the framing bytes
+	CHUNK_DONE, // the last chunk and the trailer fields were read
+	CHUNK_ERROR // the framing is invalid, getError() is the status code to answer with
+};
+
+/**
+ * @brief Incremental decoder for a request body sent with Transfer-Encoding: chunked (RFC 9112 7.1).
+ *
+ * decode() is called with the bytes at the beginning of the receive buffer. It skips the framing
+ * (chunk size lines, the line ends behind the data, the trailer fields) and tells where the next body bytes are,
+ * the caller hands them to the request and consumes framing and body from the buffer.
+ * The state is kept between the calls, a chunk size line can be split over many reads.
+ * Chunk extensions and trailer fields are read over and ignored.
+ */
+class ChunkedDecoder
+{
+	public:
+		ChunkedDecoder();
+		ChunkedDecoder(const ChunkedDecoder &src);
+		ChunkedDecoder &operator=(const ChunkedDecoder &rhs);
+		~ChunkedDecoder();
+
+		ChunkStatus		decode(const char *data, size_t size, size_t &consumed, size_t &length);
+		void			reset();
+
+		int				getError() const;
+
+	private:
+		enum State {
+			C_SIZE,
+			C_EXTENSION,
+			C_SIZE_LF,
+			C_DATA,
+			C_DATA_CR,
+			C_DATA_LF,
+			C_TRAILER_START,
+			C_TRAILER,
+			C_END_LF,
+			C_DONE
+		};
+
+		ChunkStatus		fail(int status);
+		void			endSizeLine();
+
+		State	_state;
+		size_t	_remaining; // bytes of the current chunk which were not handed out yet
+		size_t	_digits; // hex digits of the current chunk size
+		size_t	_line; // bytes of the current chunk size line
+		size_t	_trailer; // bytes of the trailer section
+		int		_error;
+};
+
+#endif
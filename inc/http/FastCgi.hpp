@@ -0,0 +1,83 @@
+#ifndef FAST_CGI_HPP
+# define FAST_CGI_HPP
+
+# include <map>
+# include <string>
+# include <vector>
+# include <sys/types.h>
+# include "../debugger/Singleton.hpp"
+# include "BodySpool.hpp"
+
+# define FASTCGI_RECORD_SIZE 32768 // content bytes of a params or stdin record we send, the protocol allows up to 65535
+# define FASTCGI_READ_SIZE 16384 // bytes read from the upstream connection at once
+# define FASTCGI_POOL_MAXIMUM_IDLE 16 // idle connections a worker keeps per upstream
+
+/**
+ * @brief Idle persistent connections to the FastCGI upstreams (fastcgi_pass) of a worker.
+ * A connection is given back once its request ended cleanly (FCGI_KEEP_CONN), the next request
+ * to the same upstream skips the connect. Every worker has its own instance (Singleton, copied by fork).
+ * USAGE: FastCgiPool::getInstance().acquire("unix:/run/php/php-fpm.sock")
+ */
+class FastCgiPool : public Singleton<FastCgiPool>
+{
+	public:
+		FastCgiPool();
+		~FastCgiPool();
+
+		int		acquire(const std::string &address);
+		void	release(const std::string &address, int fd);
+
+		static bool	isValidAddress(const std::string &address);
+
+	private:
+		static int	connectTo(const std::string &address);
+
+		std::map<std::string, std::vector<int> >	_idle;
+};
+
+/**
+ * @brief One request to a FastCGI responder (php-fpm) over a pooled connection.
+ *
+ * begin() encodes FCGI_BEGIN_REQUEST and the params, send() writes them and the request body as stdin
+ * records (from memory or the spool), read_output() decodes the answer and hands the stdout stream
+ * to the caller, which parses it exactly like the output of a cgi script.
+ * The responders we talk to do not multiplex requests on one connection (FCGI_MPXS_CONNS), so a
+ * connection serves one request at a time with request id 1 and is pooled between the requests.
+ */
+class FastCgiConnection
+{
+	public:
+		FastCgiConnection();
+		~FastCgiConnection();
+
+		bool	begin(const std::string &address, const std::map<std::string, std::string> &params,
+					const std::string &body, const BodySpool &spool);
+		int		send();
+		ssize_t	read_output(std::string &output);
+		void	finish(bool abort);
+
+		int		fd() const;
+
+	private:
+		FastCgiConnection(const FastCgiConnection &src);
+		FastCgiConnection &operator=(const FastCgiConnection &rhs);
+
+		void	appendRecord(unsigned char type, const char *content, size_t length);
+		void	appendParam(const std::string &name, const std::string &value, std::string &params);
+		bool	fillStdin();
+		bool	decodeRecords(std::string &output);
+
+		int			_fd;
+		std::string	_address;
+		std::string	_out; // encoded records which were not sent yet
+		size_t		_out_offset;
+		std::string	_body; // body of the request if it was not spooled
+		BodySpool	_spool;
+		size_t		_body_size;
+		size_t		_body_sent; // body bytes already encoded as stdin records
+		bool		_stdin_closed; // the empty stdin record is encoded
+		std::string	_in; // received bytes which do not form a complete record yet
+		bool		_ended; // FCGI_END_REQUEST was received
+};
+
+#endif
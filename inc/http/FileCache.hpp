@@ -0,0 +1,65 @@
+#ifndef FILE_CACHE_HPP
+# define FILE_CACHE_HPP
+
+# include <map>
+# include <list>
+# include <string>
+# include <ctime>
+# include <sys/stat.h>
+# include "SharedBuffer.hpp"
+# include "../debugger/Singleton.hpp"
+# include "../configuration_key/ConfigurationKey.hpp"
+
+# define FILE_CACHE_MAX_ENTRY_SIZE 262144 // bigger files are sent from the file with sendfile instead
+
+/**
+ * @brief A cached static file with the headers we derive from it.
+ */
+struct CachedFile
+{
+	SharedBuffer	body;
+	std::string		content_type;
+	std::string		etag;
+	std::string		last_modified;
+	ino_t			inode;
+	time_t			mtime;
+	off_t			size;
+	time_t			checked_at; // last time the file was compared with the disk
+	std::list<std::string>::iterator	lru; // position in the least recently used list
+};
+
+/**
+ * @brief Size bounded cache for the content of static files, keyed by the path we serve them from.
+ *
+ * Every worker has its own instance (Singleton, copied by fork).
+ * An entry is compared with the file on disk (inode, mtime and size) at most once per check interval,
+ * a changed file gets reloaded, a removed file dropped.
+ * When the cache is full the least recently used entries are dropped.
+ * A size of 0 disables the cache.
+ * USAGE: FileCache::getInstance().get(path)
+ */
+class FileCache : public Singleton<FileCache>
+{
+	public:
+		FileCache();
+		~FileCache();
+
+		void				configure(size_t max_size, int check_interval);
+		const CachedFile	*get(const std::string &path);
+
+		static std::string	makeEtag(const struct stat &st);
+		static std::string	makeHttpDate(time_t time);
+
+	private:
+		bool	load(const std::string &path, const struct stat &st);
+		void	evict(std::map<std::string, CachedFile>::iterator it);
+		void	shrink();
+
+		std::map<std::string, CachedFile>	_entries;
+		std::list<std::string>				_lru; // most recently used first
+		size_t								_max_size; // bytes
+		size_t								_size;
+		int									_check_interval;
+};
+
+#endif
@@ -5,13 +5,14 @@
 # include "Request.hpp"
 # include "Cgi.hpp"
 # include "../configuration_key/ConfigurationKey.hpp"
+# include "../configuration_key/RoutingTable.hpp"
 # include <cstdio>
 
 class Process
 {
 	public:
 	Process();
-	Process(/*Response &response, */Request request, ServerBlock config);
+	Process(/*Response &response, */Request request, const VirtualServer &server);
 	~Process(void);
 	Process &operator=(const Process &src);
 
@@ -22,19 +23,13 @@ class Process
 	void	build_response(std::string path, std::string code, std::string status);
 	void	build_dl_response(void);
 	void	server_overloaded(void);
-	void	build_cgi_response(void);
-	bool	check_location(void);
+	void	build_cgi_response(const std::string &headers, std::string &body, bool chunked);
+	void	match_location(void);
 	void	set_redirection_response(void);
 	bool	detectCgi(std::string path, std::string code, std::string status);
-	std::string	get_location(std::string location, ConfigurationKeyType type);
-	bool	get_location_dl(std::string path);
 	void	exception(int code);
 	bool	check_if_request_is_too_large();
 
-	// path builder
-	std::string build_path_with_index__or_script_file();
-	std::string getPathForNestedLocation();
-
 	Response	_response;
 	CGI			_CGI;
 	bool		_with_cgi;
@@ -42,16 +37,17 @@ class Process
 	private:
 	//Response	_response;
 	Request		_request;
-	ServerBlock	_config;
+	const VirtualServer	*_server; // compiled server block of the request, owned by the RoutingTable
+	const RouteLocation	*_location; // location serving the request, NULL if the server root serves it
+	std::string	_directory; // directory of the request below the root of _location (or the server root)
 	std::string	_cgi_path;
 	std::string	_cgi_fileending;
+	std::string	_fastcgi_pass; // the cgi files of the location are sent to this FastCGI server
 	std::string	_redirection;
 	std::string	_server_name;
 	std::vector<method>	_methods;
 	int			_pipefd_in[2];
 	int			_pipefd_out[2];
-	
-	bool	set_location_key_if_exists(ConfigurationKey &location);
 
 };
 
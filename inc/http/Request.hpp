@@ -5,6 +5,8 @@
 # include "../utility/utility.hpp"
 # include "../http/status.hpp"
 # include "../http/headers.hpp"
+# include "../http/RequestParser.hpp"
+# include "../http/BodySpool.hpp"
 
 /**
  * @note Because we have to support multiple method we need enum
@@ -28,8 +30,9 @@ typedef std::vector < std::pair < str_flag, str_flag > >	headr_dirctiv;
 
 
 /**
- * @brief Request class who get the request as raw string and
+ * @brief Request class who get the head parsed by the RequestParser and
  * store separately every element of the request in order to process it.
+ * The header fields are not copied one by one, they stay slices of the raw head.
  */
 class Request
 {
@@ -57,9 +60,14 @@ class Request
 		str_flag			getBody(void) const;
 		//std::string			getStatus(void) const;
 
-		void				parser(std::string &req);
-			void				setMethod(std::string &req);
-			void				setUrl(std::string &req);
+		unsigned long		getContentLength(void) const;
+		bool				isChunked(void) const;
+		size_t				getBodySize(void) const;
+		const BodySpool		&getSpool(void) const;
+
+		void				parse(const char *head, const RequestParser &parser);
+			void				setMethod(const std::string &method);
+			void				setUrl(std::string &url);
 				void				setProtocol(std::string &url);
 				void				setDomain(std::string &url);
 				void				setPort(std::string &url);
@@ -67,10 +75,9 @@ class Request
 				void				setPath(std::string &url);
 				void				setQuery(std::string &url);
 				void				setFragment(std::string &url);
-			void				setHttpversion(std::string &req);
-			void				setHeaders(std::string &req);
-				void			checkHeader(str_flag &hdr, str_flag &direct);
-			void				setBody(std::string &req);
+			void				setHttpversion(const std::string &version);
+			void				checkHeader(const HeaderField &field);
+		void				appendBody(const char *data, size_t size);
 
 		bool hasNestedRequestPath; // flag if the request path is nested
 	private:
@@ -84,8 +91,16 @@ class Request
 		str_flag			_query;
 		str_flag			_fragment;
 		str_flag			_httpVersion;
-		headr_dirctiv		_headers;
-		str_flag			_body;
+		std::string					_head; // copy of the raw head, the header fields point into it
+		std::vector<HeaderField>	_fields;
+		unsigned long				_content_length;
+		bool						_chunked; // the body is sent with Transfer-Encoding: chunked
+		str_flag					_body; // the body if it is small enough to stay in memory
+		BodySpool					_spool; // the body once it got bigger than BODY_MEMORY_LIMIT
+		size_t						_body_size;
+
+		std::string			slice(const HeadSlice &slice) const;
+		bool				isField(const HeaderField &field, const std::string &name) const;
 };
 
 /**
@@ -0,0 +1,95 @@
+#ifndef REQUEST_PARSER_HPP
+# define REQUEST_PARSER_HPP
+
+# include <string>
+# include <vector>
+
+# define REQUEST_LINE_MAXIMUM_SIZE 8192 // a longer request line is answered with 414
+# define REQUEST_HEAD_MAXIMUM_SIZE 16384 // a bigger head (request line and headers) is answered with 431
+# define REQUEST_HEADERS_MAXIMUM 100 // more header fields are answered with 431
+
+enum ParseStatus {
+	PARSE_NEED_MORE, // the head is not complete yet, call parse() again once more bytes arrived
+	PARSE_COMPLETE, // the head is complete, getHeadSize() bytes belong to it
+	PARSE_ERROR // the head is invalid, getError() is the status code to answer with
+};
+
+/**
+ * @brief Part of the head, as offset and length relative to the first byte of the head
+ */
+struct HeadSlice
+{
+	size_t	offset;
+	size_t	length;
+};
+
+/**
+ * @brief A header field, the value is stripped from the surrounding whitespaces
+ */
+struct HeaderField
+{
+	HeadSlice	name;
+	HeadSlice	value;
+};
+
+/**
+ * @brief Resumable parser for the head of a http request (request line and header fields).
+ *
+ * parse() gets the whole receive buffer every time, but only looks at the bytes it did not see before,
+ * the state (position, current element) is kept between the calls. A head arriving in many small reads
+ * is therefore scanned exactly once.
+ * Nothing is copied, the elements are recorded as slices of the buffer. They stay valid
+ * as long as the bytes in front of the head are not touched, call reset() before parsing the next head.
+ */
+class RequestParser
+{
+	public:
+		RequestParser();
+		RequestParser(const RequestParser &src);
+		RequestParser &operator=(const RequestParser &rhs);
+		~RequestParser();
+
+		ParseStatus		parse(const char *data, size_t size);
+		void			reset();
+
+		int								getError() const;
+		size_t							getHeadSize() const;
+		const HeadSlice					&getMethod() const;
+		const HeadSlice					&getTarget() const;
+		const HeadSlice					&getVersion() const;
+		const std::vector<HeaderField>	&getFields() const;
+
+	private:
+		enum State {
+			S_START,
+			S_METHOD,
+			S_TARGET,
+			S_VERSION,
+			S_REQUEST_LINE_LF,
+			S_FIELD_START,
+			S_FIELD_NAME,
+			S_FIELD_VALUE_START,
+			S_FIELD_VALUE,
+			S_FIELD_LF,
+			S_HEAD_END_LF,
+			S_DONE
+		};
+
+		ParseStatus		fail(int status);
+		int				checkVersion(const char *data) const;
+
+		static bool		isToken(char c);
+
+		State						_state;
+		size_t						_pos; // next byte to look at
+		size_t						_mark; // first byte of the current element
+		size_t						_value_end; // end of the current field value without trailing whitespaces
+		int							_error;
+		HeadSlice					_method;
+		HeadSlice					_target;
+		HeadSlice					_version;
+		HeaderField					_field;
+		std::vector<HeaderField>	_fields;
+};
+
+#endif
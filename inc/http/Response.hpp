@@ -9,6 +9,11 @@
 # include "../configuration_key/ServerBlock.hpp"
 # include "../configuration_key/ConfigurationKey.hpp"
 # include "Request.hpp"
+# include "SharedBuffer.hpp"
+# include "FileCache.hpp"
+
+# define SENDFILE_THRESHOLD 16384 // static files from this size on are sent from the file instead of being read into memory
+# define FILE_FORMAT_SNIFF_SIZE 1024 // bytes at the beginning of a file used to guess its content type
 
 /**
  * @brief class that is used to generate the response
@@ -18,12 +23,12 @@ class Response
 {
 	public:
 	Response();
-	Response(Request request, ServerBlock config);
 	~Response(void);
 
 	void	process_request(void);
 	void	create_response(void);
-	std::string	&get_response(void);
+	std::string	&get_head(void);
+	std::string	&get_payload(void);
 
 	void	set_protocol(std::string protocol);
 	void	set_status_code(std::string status_code);
@@ -34,7 +39,12 @@ class Response
 	void	set_charset(std::string charset);
 	void	set_content_length(std::string content_length);
 	void	set_transfer_encoding(std::string transfer_encoding);
+	void	set_connection(std::string connection);
 	void	set_body(std::string body);
+	void	set_headers_raw(std::string headers_raw);
+	bool	set_body_file(std::string path);
+	void	set_cached_body(const CachedFile &file);
+	void	set_prerendered(const SharedBuffer &response);
 
 	std::string	get_protocol(void);
 	std::string	get_status_code(void);
@@ -45,14 +55,17 @@ class Response
 	std::string	get_charset(void);
 	std::string	get_content_length(void);
 	std::string	get_transfer_encoding(void);
+	std::string	get_connection(void);
 	std::string	get_body(void);
+	const SharedBuffer	&get_shared_body(void);
+	bool		has_body_file(void);
+	size_t		get_body_file_size(void);
+	int			release_body_file(void);
 
 	std::string	get_file_format(void);
+	static std::string	sniff_file_format(const std::string &content);
 
 	private:
-	Request		_request;
-	ServerBlock	_config;
-	std::vector<ConfigurationKey>	_vec_loc;
 	std::string	_protocol;
 	std::string	_status_code;
 	std::string	_status_text;
@@ -62,14 +75,20 @@ class Response
 	std::string	_charset;
 	std::string	_content_length;
 	std::string	_transfer_encoding;
+	std::string	_connection;
 	std::string	_body;
-	std::string	_raw_body;
 	std::string	_headers_raw;
+	int			_body_fd; // file the body is sent from (-1 if the body is in _body), owned by whoever releases it
+	size_t		_body_file_size;
+	std::string	_body_head; // beginning of the body file, to guess the content type
+	SharedBuffer	_shared_body; // body of a cached file, sent without copying it
+	std::string	_etag;
+	std::string	_last_modified;
 	// std::string _html;
 	// std::string _plain;
 	// std::string _image;
 
-	std::string	_response;
+	std::string	_head;
 
 };
 
@@ -0,0 +1,38 @@
+#ifndef SHARED_BUFFER_HPP
+# define SHARED_BUFFER_HPP
+
+# include <string>
+
+/**
+ * @brief Immutable reference counted bytes.
+ * Copying a SharedBuffer only increments the counter, so the same content (a cached file, a pre-rendered page)
+ * can be queued for many clients at the same time without being copied.
+ * The counter is not atomic, a buffer must not be shared between threads (processes are fine, they get a copy with fork).
+ */
+class SharedBuffer
+{
+	public:
+		SharedBuffer();
+		explicit SharedBuffer(std::string &content);
+		SharedBuffer(const SharedBuffer &src);
+		SharedBuffer &operator=(const SharedBuffer &src);
+		~SharedBuffer();
+
+		const char			*data() const;
+		size_t				size() const;
+		bool				empty() const;
+		const std::string	&str() const;
+
+	private:
+		struct Block
+		{
+			std::string		content;
+			unsigned int	refs;
+		};
+
+		void	release();
+
+		Block	*_block;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef SPAWN_BLOCK_HPP
+# define SPAWN_BLOCK_HPP
+
+# include <string>
+# include <vector>
+# include <sys/types.h>
+
+/**
+ * @brief argv and environment of a cgi script, assembled in one arena before the script is started.
+ *
+ * The arena holds the amount of arguments followed by the arguments and then the "NAME=value" pairs,
+ * every string zero terminated. spawn() only points argv and envp into the arena, nothing is allocated
+ * per variable and nothing is built after the split. The arena is also the job a CgiHelperPool helper receives.
+ * spawn() uses posix_spawn (vfork-like clone in glibc), so its cost does not grow with the size
+ * of the worker (memory, filedescriptors) like fork() does.
+ * USAGE: block.addArgument("/bin/sh"); block.addArgument("./index.sh"); block.addEnvironment("GATEWAY_INTERFACE", "CGI/1.1"); block.spawn(in, out);
+ */
+class SpawnBlock
+{
+	public:
+		SpawnBlock();
+		~SpawnBlock();
+
+		void				addArgument(const std::string &argument);
+		void				addEnvironment(const std::string &name, const std::string &value);
+		bool				assign(const std::string &data);
+		const std::string	&data() const;
+		bool				empty() const;
+
+		pid_t				spawn(int in, int out);
+
+	private:
+		void	setArgumentCount(unsigned int count);
+
+		std::string			_arena;
+		unsigned int		_argc;
+		std::vector<char *>	_pointers; // argv, NULL, envp, NULL (into _arena, built by spawn)
+};
+
+#endif
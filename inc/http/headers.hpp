@@ -8,6 +8,7 @@
 #define Accept_Language "Accept-Language"
 #define Allow "Allow"
 #define Authorization "Authorization"
+#define Connection "Connection"
 #define Content_Language "Content-Language"
 #define Content_Length "Content-Length"
 #define Content_Location "Content-Location"
@@ -0,0 +1,34 @@
+#ifndef BINARY_UPGRADE_HPP
+# define BINARY_UPGRADE_HPP
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "../debugger/Singleton.hpp"
+
+#define LISTEN_FDS_VARIABLE "WEBSERV_LISTEN_FDS" // listening sockets handed to the new binary, "fd;fd;..."
+
+/**
+ * @brief Replaces the running binary without closing a listening socket (SIGUSR2, like nginx does it).
+ *
+ * start() forks and executes the binary at the path the server was started with (it may have been replaced
+ * on disk), with the same arguments. The listening sockets stay open across exec and their numbers are passed
+ * in LISTEN_FDS_VARIABLE, the new binary takes them over with inheritedSockets() instead of binding the ports again.
+ * Both binaries accept on the same sockets until the old one is stopped with SIGQUIT, so no connection is refused.
+ * USAGE: remember(argv) in main, inheritedSockets() before the ports are opened, start(fds) on SIGUSR2.
+ */
+class BinaryUpgrade : public Singleton<BinaryUpgrade>
+{
+	public:
+		BinaryUpgrade();
+		~BinaryUpgrade();
+
+		void				remember(char **argv);
+		std::vector<int>	inheritedSockets();
+		pid_t				start(const std::vector<int> &listening_fds);
+
+	private:
+		std::vector<std::string>	_arguments;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef CHILD_SUPERVISOR_HPP
+# define CHILD_SUPERVISOR_HPP
+
+#include <map>
+#include <ctime>
+#include <sys/types.h>
+#include "../debugger/Singleton.hpp"
+
+#define CHILD_EXIT_GRACE 5 // seconds a cgi may keep running after it closed its output, then it gets killed
+
+/**
+ * @brief Reaps the cgi processes of a worker without ever waiting for them.
+ *
+ * SIGCHLD only writes a byte into a non blocking self-pipe, the read end is registered in the event loop
+ * and reap() collects every child which exited with waitpid(WNOHANG) once it becomes readable.
+ * Only children which were watched and not reaped yet are ever signalled, a reaped pid might belong to someone else.
+ * A child which is still running when its client is done with it is either killed (terminate) or gets a
+ * deadline (release), expire() kills the children whose deadline passed. Every child runs in its own
+ * process group, killing the group also stops whatever the script started.
+ * USAGE: ChildSupervisor::getInstance().install() once in the worker, then getFd() into the event loop.
+ */
+class ChildSupervisor : public Singleton<ChildSupervisor>
+{
+	public:
+		ChildSupervisor();
+		~ChildSupervisor();
+
+		bool	install();
+		int		getFd() const;
+
+		void	watch(pid_t pid);
+		void	reap();
+		void	terminate(pid_t pid);
+		void	release(pid_t pid);
+		void	expire(std::time_t now);
+		bool	hasChildren() const;
+
+	private:
+		static void	notify(int signum);
+
+		static int	_pipe[2];
+		std::map<pid_t, std::time_t>	_children; // running children and their deadline (0 while a client needs them)
+};
+
+#endif
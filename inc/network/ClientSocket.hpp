@@ -2,12 +2,24 @@
 # define CLIENT_SOCKET_HPP
 
 #include "../http/Request.hpp"
+#include "../http/ChunkedDecoder.hpp"
 #include "../utility/utility.hpp"
 #include "../http/status.hpp"
 #include "../http/Response.hpp"
 #include "../http/Process.hpp"
+#include "../configuration_key/ConfigSnapshot.hpp"
+#include "OutputQueue.hpp"
+#include "ReceiveBuffer.hpp"
+#include "TimerWheel.hpp"
 #include <poll.h>
 #include <ctime>
+#include <cerrno>
+#include <deque>
+
+#define MAXIMUM_PIPELINED_REQUESTS 32 // requests parsed ahead on one connection, the rest waits in the buffer
+#define PIPELINE_OUTPUT_LIMIT 65536 // stop batching responses of pipelined requests once the output is that big
+#define CGI_OUTPUT_LIMIT 65536 // cgi output collected before it is sent, even if the script has more to say
+#define CGI_TIMEOUT 5 // seconds a cgi may run without producing any output
 
 enum	states {HEADER, BODY, RESPONSE, PIPE};
 
@@ -29,17 +41,26 @@ class ClientSocket
 {
 	public:
 
-		ClientSocket(struct sockaddr_in clientSocket, ServerBlock &config, int forward, ConfigFileParsing configFile);
+		ClientSocket(struct sockaddr_in clientSocket, const ConfigSnapshot &config, int forward);
 		virtual ~ClientSocket();
 
 		void	call_func_ptr(void);
 
 		void	read_in_buffer(void);
+		bool	parse_requests(void);
+		bool	read_body(void);
+		bool	append_body(const char *data, size_t size);
+		void	serve_queued_requests(void);
+		void	reject(int status, const VirtualServer &server);
+		void	reject_request(void);
+		void	queue_response(void);
+		void	start_sending(void);
 		void	send_response(void);
 
-		void	one(void);
 		void	two(void);
 		void	three(void);
+		void	write_fastcgi(void);
+		void	relay_cgi_output(bool eof);
 
 		void	process_request(void);
 		void	get_request(void);
@@ -51,36 +72,67 @@ class ClientSocket
 		void	exception(int e);
 
 		void	set_up();
+		bool	wants_keep_alive(const VirtualServer &server);
+		void	finish_response(void);
+		void	reset(void);
+		void	reconfigure(const ConfigSnapshot &config);
+		void	drain(void);
 
 		
-		bool Timeout(void);
+		unsigned long deadline(void) const;
+		void expire(void);
+		bool isWaitingForRequest(void) const;
+		bool isIdle(void) const;
+		bool isWaitingForCgi(void) const;
+		bool cgiTimeout(void);
 		
 		short				_event;
 		int					_fd;
 		int					_client_fd;
 		bool				_remove;
+		bool				_would_block; // the last read/write on _fd returned EAGAIN, wait for the event loop
 		SOCKET_STATE		_socket_state;
 		
 		int					timestamp;
 
 		Process				_process;
 		Request				_clientRequest;
+		Timer				_timer; // scheduled by the ServerSocket for deadline(), the owner is the client
 
 	private:
 
 		struct sockaddr_in	_socket;
-		ServerBlock			_config;
-		ConfigFileParsing	_configFile;
+		ConfigSnapshot		_config; // keeps the configuration of the connection alive, the requests point into it
+		ConfigSnapshot		_next_config; // reloaded configuration, taken over once the current request is done
 		int					_fd_cgi;
 		int					_bytes;
-		size_t				_count;
-		unsigned long		_position;
-		std::string			buffer;
-		std::time_t			_timeout;
+		ReceiveBuffer		buffer; // received bytes which are not part of a parsed request yet
+		RequestParser		_parser; // parses the head at the beginning of the buffer, keeps its state between the reads
+		ChunkedDecoder		_chunked; // decodes the body of _pendingRequest if it is chunked
+		Request				_pendingRequest; // request whose header was parsed, waiting for its body
+		std::deque<Request>	_requests; // complete requests waiting to be served, in the order they arrived
+		OutputQueue			_output; // responses waiting to be sent, in the order of the requests
+		unsigned long		_header_start; // milliseconds (TimerWheel::now), the client started sending the current head
+		unsigned long		_last_progress; // milliseconds, last read of the body, write of the response or end of the last response
 		states				_state;
-		unsigned long		_content_length;
+		unsigned long		_content_length; // body bytes of _pendingRequest which did not arrive yet
+		bool				_keep_alive; // the connection stays open after the current response
+		bool				_draining; // the server stops, the connection is closed after the current response
+		int					_keepalive_timeout;
+		int					_keepalive_requests;
+		int					_header_timeout; // seconds, the limits of the server block of the current request
+		int					_body_timeout;
+		int					_send_timeout;
+		int					_requests_served;
+		int					_parse_error; // status code of a rejected request, answered once the requests in front of it are served
+		SharedBuffer		_rejection; // the error response for _parse_error
+		unsigned long		_body_limit; // post_max_size of the server block of _pendingRequest
+		std::string			_cgi_output; // output of the cgi which was not relayed yet
+		bool				_cgi_stream; // the cgi output is relayed while the script runs (chunked)
+		bool				_cgi_head_sent; // the head of the cgi response is in _output
+		unsigned long		_cgi_activity; // milliseconds, last time the cgi produced output
 		void					(ClientSocket::*_func_ptr)(void);
-		ServerBlock			getServerBlock();
+		const VirtualServer	&getServer(Request &request);
 		
 };
 
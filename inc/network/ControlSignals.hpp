@@ -0,0 +1,37 @@
+#ifndef CONTROL_SIGNALS_HPP
+# define CONTROL_SIGNALS_HPP
+
+#include <csignal>
+#include "../debugger/Singleton.hpp"
+
+/**
+ * @brief The signals an operator sends to control the server.
+ * SIGHUP reloads the configuration, SIGTERM and SIGQUIT stop the server once the requests in flight are done,
+ * SIGUSR2 starts a new binary on the same listening sockets.
+ *
+ * The handler only marks the signal as received and writes a byte into a non blocking self-pipe, the read end
+ * is registered in the event loop of a worker, so the signal is handled between two events and never inside
+ * the handler. The master polls the read end between two checks of its workers.
+ * Every process calls install() itself, a forked worker gets a new pipe instead of sharing the one of the master.
+ * A process which is not controlled by the operator (the cgi helper zygote) calls uninstall() right after the fork.
+ * USAGE: ControlSignals::getInstance().install(), getFd() into the event loop, received(signum) once it is readable.
+ */
+class ControlSignals : public Singleton<ControlSignals>
+{
+	public:
+		ControlSignals();
+		~ControlSignals();
+
+		bool	install();
+		void	uninstall();
+		int		getFd() const;
+		bool	received(int signum);
+
+	private:
+		static void	notify(int signum);
+
+		static int						_pipe[2];
+		static volatile sig_atomic_t	_received[NSIG];
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef EPOLL_EVENT_LOOP_HPP
+# define EPOLL_EVENT_LOOP_HPP
+
+#include "EventLoop.hpp"
+
+#ifdef __linux__
+
+# include <map>
+# include <exception>
+# include <sys/epoll.h>
+
+# define NOT_WATCHED -1
+# define EPOLL_MAX_EVENTS 1024 // maximum number of ready filedescriptors returned by one epoll_wait call
+
+/**
+ * @brief Edge triggered backend built on epoll (linux only).
+ *
+ * Every filedescriptor is registered with EPOLLET, so the kernel only reports a transition to ready once.
+ * The owner of the filedescriptor has to drain it (read/write until EAGAIN) before going back to wait().
+ *
+ * Regular files cannot be registered with epoll, the kernel rejects them with EPERM.
+ * They are always ready for I/O anyway, so they are kept aside and reported on every wait() like poll() would do.
+ *
+ * The registered events are kept in a table indexed by filedescriptor, so we can skip epoll_ctl calls
+ * which would not change anything.
+ */
+class EpollEventLoop : public EventLoop
+{
+	public:
+		EpollEventLoop();
+		virtual ~EpollEventLoop();
+
+		virtual bool	add(int fd, short events);
+		virtual bool	modify(int fd, short events);
+		virtual void	remove(int fd);
+		virtual int		wait(std::vector<IoEvent> &ready, int timeout);
+
+		virtual bool		isEdgeTriggered() const;
+		virtual const char	*getName() const;
+
+		// gets thrown if epoll_create fails, the caller falls back to poll.
+		class EpollCreationError : public std::exception {
+			public:
+				virtual const char* what() const throw() {
+					return "epoll instance couldn't be created, check errno.";
+				}
+		};
+
+	private:
+		EpollEventLoop(const EpollEventLoop &src);
+		EpollEventLoop &operator=(const EpollEventLoop &src);
+
+		static unsigned int	toEpollEvents(short events);
+		static short		toPollEvents(unsigned int events);
+
+		short	getInterest(int fd) const;
+
+		int									_epfd;
+		std::vector<short>					_interests; // registered poll events per fd, NOT_WATCHED if unknown to epoll
+		std::map<int, short>				_always_ready;
+		std::vector<struct epoll_event>		_events;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef EVENT_LOOP_HPP
+# define EVENT_LOOP_HPP
+
+#include <vector>
+#include <poll.h>
+
+/**
+ * @brief A single readiness notification returned by EventLoop::wait.
+ * The events are always expressed with the poll() flags (POLLIN, POLLOUT, POLLERR, POLLHUP, POLLNVAL),
+ * no matter which backend produced them, so the clients do not need to know about the backend.
+ */
+struct IoEvent
+{
+	int		fd;
+	short	events;
+};
+
+/**
+ * @brief Interface of the I/O multiplexing backend used by the ServerSocket.
+ *
+ * The ServerSocket registers every filedescriptor it is interested in (listening sockets, client sockets, cgi files)
+ * with add(), updates the interest with modify() whenever a client switches between reading and writing and
+ * unregisters it with remove() before closing it. wait() only returns the filedescriptors which are actually ready,
+ * so the cost of one iteration of the main loop does not depend on the number of idle connections.
+ *
+ * Use EventLoop::create() to get the best backend available on the platform.
+ */
+class EventLoop
+{
+	public:
+		virtual ~EventLoop() {};
+
+		virtual bool	add(int fd, short events) = 0;
+		virtual bool	modify(int fd, short events) = 0;
+		virtual void	remove(int fd) = 0;
+		virtual int		wait(std::vector<IoEvent> &ready, int timeout) = 0;
+
+		/**
+		 * @brief Edge triggered backends only report a filedescriptor again once new data arrived (or space got free).
+		 * The caller has to read/write until the operation would block before waiting again.
+		 */
+		virtual bool		isEdgeTriggered() const = 0;
+		virtual const char	*getName() const = 0;
+
+		static EventLoop	*create();
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef MASTER_HPP
+# define MASTER_HPP
+
+#include <vector>
+#include <ctime>
+#include <sys/types.h>
+#include "../configuration_key/ConfigSnapshot.hpp"
+
+#define MASTER_INTERVAL 1000 // milliseconds between two checks of the workers
+
+/**
+ * @brief Master process of the multi-core mode (worker_processes > 1)
+ *
+ * For every worker the Master opens its own set of SO_REUSEPORT listening sockets (one per port of all server blocks)
+ * and forks the worker, which only keeps its set and runs its own ServerSocket event loop.
+ * The kernel load-balances the incoming connections between the sockets of the same port,
+ * so the workers do not share any mutable state.
+ *
+ * The Master never accepts connections itself, it only keeps the sockets open and supervises the workers.
+ * A worker which dies is restarted on the same sockets, so connections waiting in its queue are not lost.
+ * SIGHUP makes the Master validate the configuration file and forward the signal to the workers, which reload it
+ * themselves. The Master closes its copies of the sockets of removed ports, added ports are opened by the workers.
+ * SIGTERM and SIGQUIT are forwarded as well, run() returns once every worker finished its requests.
+ * SIGUSR2 starts a new binary on the sockets of all workers (BinaryUpgrade).
+ */
+class Master
+{
+	public:
+		Master(const ConfigSnapshot &config, unsigned int address, int workers);
+		~Master();
+
+		void	run();
+
+	private:
+		Master(const Master &src);
+		Master &operator=(const Master &src);
+
+		void	spawnWorker(int slot);
+		int		findWorker(pid_t pid);
+		void	reload();
+		void	stop(int signum);
+		void	upgrade();
+		bool	hasWorkers() const;
+
+		ConfigSnapshot					_config; // compiled once, the workers get it with fork
+		unsigned int					_address; // network interface of the listening sockets
+		std::vector<std::vector<int> >	_listeners; // listening sockets of each worker
+		std::vector<pid_t>				_pids;
+		std::vector<std::time_t>		_started;
+		bool							_stopping; // the workers were told to stop, they are not restarted
+};
+
+#endif
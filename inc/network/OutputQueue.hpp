@@ -0,0 +1,61 @@
+#ifndef OUTPUT_QUEUE_HPP
+# define OUTPUT_QUEUE_HPP
+
+#include <deque>
+#include <string>
+#include <sys/types.h>
+#include "../http/SharedBuffer.hpp"
+
+#define NO_FILE -1
+#define OUTPUT_MAX_IOVEC 64 // data segments gathered into one writev call
+
+/**
+ * @brief One piece of the output of a client.
+ * Either bytes in memory (data) or a region of an open file (fd, offset, length) which is sent without copying it to user space.
+ */
+struct OutputSegment
+{
+	SharedBuffer	data;
+	size_t		sent; // bytes of data already sent
+	int			fd;
+	off_t		offset;
+	size_t		length; // bytes of the file region left to send
+};
+
+/**
+ * @brief The responses waiting to be sent to one client, in the order of the requests.
+ *
+ * Data segments take over the string they are given (swap, no copy) or share the buffer they are given,
+ * a response is queued as its head and its body.
+ * Consecutive data segments (heads, bodies, several pipelined responses) are sent with a single writev call.
+ * File segments own their filedescriptor and close it once they are sent (or the queue is cleared).
+ * On linux and macOS file regions are sent with sendfile(), the kernel copies them straight from the page cache.
+ */
+class OutputQueue
+{
+	public:
+		OutputQueue();
+		~OutputQueue();
+
+		void	pushData(std::string &data);
+		void	pushShared(const SharedBuffer &data);
+		void	pushFile(int fd, off_t offset, size_t length);
+		ssize_t	sendTo(int socket);
+		void	clear();
+
+		bool	empty() const;
+		size_t	size() const;
+
+	private:
+		OutputQueue(const OutputQueue &src);
+		OutputQueue &operator=(const OutputQueue &src);
+
+		ssize_t	sendFileRegion(int socket, OutputSegment &segment);
+		ssize_t	sendDataSegments(int socket);
+		void	popFront();
+
+		std::deque<OutputSegment>	_segments;
+		size_t						_size; // bytes left to send in all segments
+};
+
+#endif
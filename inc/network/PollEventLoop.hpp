@@ -0,0 +1,37 @@
+#ifndef POLL_EVENT_LOOP_HPP
+# define POLL_EVENT_LOOP_HPP
+
+#include "EventLoop.hpp"
+
+/**
+ * @brief Portable level triggered backend built on poll().
+ * Used as fallback when epoll is not available (macOS) or could not be initialised.
+ *
+ * _index is indexed by filedescriptor and holds the position of its pollfd in _pollfds (-1 if not watched).
+ * Removing swaps the last pollfd in the freed place, so all operations except wait() are constant time.
+ */
+class PollEventLoop : public EventLoop
+{
+	public:
+		PollEventLoop();
+		virtual ~PollEventLoop();
+
+		virtual bool	add(int fd, short events);
+		virtual bool	modify(int fd, short events);
+		virtual void	remove(int fd);
+		virtual int		wait(std::vector<IoEvent> &ready, int timeout);
+
+		virtual bool		isEdgeTriggered() const;
+		virtual const char	*getName() const;
+
+	private:
+		PollEventLoop(const PollEventLoop &src);
+		PollEventLoop &operator=(const PollEventLoop &src);
+
+		int	find(int fd) const;
+
+		std::vector<pollfd>	_pollfds;
+		std::vector<int>	_index;
+};
+
+#endif
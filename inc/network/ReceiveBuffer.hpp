@@ -0,0 +1,64 @@
+#ifndef RECEIVE_BUFFER_HPP
+# define RECEIVE_BUFFER_HPP
+
+#include <vector>
+#include <sys/types.h>
+#include "../debugger/Singleton.hpp"
+
+#define RECEIVE_SLAB_SIZE 16384 // storage of a receive buffer, grows beyond only for a burst of pipelined requests
+#define RECEIVE_POOL_MAXIMUM_FREE 256 // free slabs a worker keeps for the next reads, the rest is freed
+
+/**
+ * @brief Free list of the slabs used by the receive buffers.
+ * Every worker has its own instance (Singleton, copied by fork), so there is no locking.
+ * USAGE: SlabPool::getInstance().acquire()
+ */
+class SlabPool : public Singleton<SlabPool>
+{
+	public:
+		SlabPool();
+		~SlabPool();
+
+		char	*acquire();
+		void	release(char *slab);
+
+	private:
+		std::vector<char *>	_free;
+};
+
+/**
+ * @brief Bytes received from a client which were not consumed yet.
+ *
+ * The bytes are read straight into the free space at the tail, consuming only moves the start forward,
+ * so neither a read nor handing a body to the request shifts the remaining bytes.
+ * They are only moved to the front once the tail is full.
+ * The storage is a slab of the SlabPool which is given back as soon as everything was consumed,
+ * an idle keep-alive connection does not hold any memory.
+ */
+class ReceiveBuffer
+{
+	public:
+		ReceiveBuffer();
+		~ReceiveBuffer();
+
+		ssize_t		readFrom(int fd);
+		void		consume(size_t size);
+
+		const char	*data() const;
+		size_t		size() const;
+		bool		empty() const;
+
+	private:
+		ReceiveBuffer(const ReceiveBuffer &src);
+		ReceiveBuffer &operator=(const ReceiveBuffer &rhs);
+
+		void		reserve();
+		void		releaseStorage();
+
+		char		*_storage;
+		size_t		_capacity;
+		size_t		_start; // first byte not consumed yet
+		size_t		_end; // behind the last byte received
+};
+
+#endif
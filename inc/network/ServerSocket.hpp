@@ -5,23 +5,42 @@
 #include <cerrno>
 #include "../utility/utility.hpp"
 #include "../configuration_key/ServerBlock.hpp"
+#include "../configuration_key/ConfigSnapshot.hpp"
 #include "./ClientSocket.hpp"
+#include "./EventLoop.hpp"
+#include "./TimerWheel.hpp"
 
 #define BACKLOG 25 // maximum number of allowed incoming connection in the queue until being accept()
 
 #define MAXIMUM_CONNECTED_CLIENTS 100 // maximum number of connected clients
 
+#define NO_CLIENT -1 // value of an unused entry in the fd -> client slot table
+
+#define SWEEP_INTERVAL 1000 // longest wait of the event loop while cgi scripts run or the server drains (milliseconds)
+
+#define SHUTDOWN_TIMEOUT 30 // seconds the clients get to finish their requests after SIGTERM or SIGQUIT
+
 /**
  * @brief Server Socket listening for requests
+ *
+ * The clients are stored densely in _clients as pair of [registered fd, client].
+ * _client_slots is indexed by filedescriptor and holds the position of the client in _clients,
+ * so finding the client of a ready fd, adding and removing (swap with the last one) are constant time.
+ * Every client has one timer in _timers for the deadline of what it currently waits for,
+ * the event loop sleeps until the next deadline and only the expired clients are looked at.
  */
-typedef std::vector<std::pair<int, ClientSocket> >::iterator	client_iter;
 
 class ServerSocket
 {
 
 	public:
 
-		ServerSocket(ServerBlock serverBlock, ConfigFileParsing configFile, unsigned int address);
+		ServerSocket(const ConfigSnapshot &config, unsigned int address);
+		ServerSocket(const ConfigSnapshot &config, unsigned int address, std::vector<int> listening_fds);
+
+		static std::vector<int>	openListeningSockets(std::vector<unsigned int> ports, unsigned int address, bool reuse_port);
+		static unsigned int		listeningPort(int fd);
+		static std::vector<unsigned int>	missingPorts(const std::vector<unsigned int> &ports, const std::vector<int> &fds);
 
 		//ServerSocket( const ServerSocket &src );
 		virtual ~ServerSocket();
@@ -30,7 +49,7 @@ class ServerSocket
 
 		void processConnections();
 
-		client_iter	get_CS_position(std::vector<std::pair<int, ClientSocket> > &vector, int key);
+		int	get_CS_position(int fd);
 
 		// gets thrown if socket creation is faulty.
 		class SocketCreationError : public std::exception {
@@ -41,18 +60,35 @@ class ServerSocket
 		};
 
 	private:
-		void removeIfNecessary(std::vector<pollfd> pollfds, int i);
 		std::vector<int>	_fds;
-		std::vector<struct sockaddr_in>	_sockets;
 		//std::map<int, ClientSocket> _clients;
 		//std::map<unsigned long, ClientSocket> _clients;
-		void disconnectClient(std::vector<pollfd> &pollfds, int i);
-		bool acceptNewConnectionsIfAvailable(std::vector<pollfd> &pollfds, int i);
-		void checkIfConnectionIsBroken(std::vector<pollfd> &pollfds, int i);
-		void socketFailed(std::vector<pollfd> &pollfds, int i);
-		std::vector<std::pair<int, ClientSocket> >	_clients;
-		ServerBlock	_serverBlock;
-		ConfigFileParsing _configFile;
+		bool isListeningSocket(int fd);
+		void disconnectClient(int pos);
+		bool acceptNewConnectionsIfAvailable(int listening_fd);
+		void checkIfConnectionIsBroken(int pos, short revents);
+		void dispatchClient(int pos);
+		void updateClientInterest(int pos);
+		void expireTimers();
+		int nextTimeout();
+		void reload();
+		void upgrade();
+		void drain();
+		void handleControlSignals();
+		void syncListeningSockets();
+		void linkClientSlot(int fd, int pos);
+		void removeClientSlot(int pos);
+		std::vector<std::pair<int, ClientSocket *> >	_clients;
+		std::vector<int>	_client_slots;
+		ConfigSnapshot	_config; // the current configuration, every client keeps a reference to the one it started with
+		unsigned int	_address; // network interface of the listening sockets
+		bool			_reuse_port; // the listening sockets are shared with other workers (SO_REUSEPORT)
+		EventLoop	*_loop;
+		bool		_draining; // stopped accepting, the loop ends once the clients are done
+		std::time_t	_drain_deadline; // the remaining clients are disconnected at this time
+		TimerWheel	_timers; // deadlines of the clients
+		std::vector<Timer *>	_expired; // timers returned by the last advance of _timers
+		std::time_t	_last_sweep; // last check for cgi scripts to kill
 		unsigned int listeningSockets;
 };
 
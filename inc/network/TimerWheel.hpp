@@ -0,0 +1,81 @@
+#ifndef TIMER_WHEEL_HPP
+# define TIMER_WHEEL_HPP
+
+#include <cstddef>
+#include <vector>
+
+#define TIMER_TICK 10 // milliseconds per slot of the lowest level
+#define TIMER_LEVELS 4 // levels of the wheel, together they cover TIMER_SLOTS^TIMER_LEVELS ticks (about 46 hours)
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS (1 << TIMER_SLOT_BITS) // slots per level
+
+class TimerWheel;
+
+/**
+ * @brief A deadline which can be scheduled in a TimerWheel, embedded in the object it belongs to.
+ * The timer links itself into the slot of its deadline, so (re)scheduling and cancelling are constant time.
+ * A timer which is destroyed while it is scheduled removes itself from the wheel.
+ */
+class Timer
+{
+	public:
+		Timer(void *owner);
+		~Timer();
+
+		bool			isScheduled() const;
+		unsigned long	deadline() const;
+		void			*owner() const;
+
+	private:
+		Timer(const Timer &src);
+		Timer &operator=(const Timer &rhs);
+
+		friend class TimerWheel;
+
+		void			*_owner; // the object the timer belongs to, returned with the expired timers
+		TimerWheel		*_wheel; // wheel the timer is scheduled in, NULL otherwise
+		Timer			*_prev;
+		Timer			*_next;
+		unsigned long	_deadline; // milliseconds on the TimerWheel::now() clock
+		int				_level;
+		int				_slot;
+};
+
+/**
+ * @brief Hierarchical timing wheel of the event loop, expires the timers of the connections.
+ *
+ * Every level has TIMER_SLOTS slots, a slot of level n stands for TIMER_SLOTS^n ticks of TIMER_TICK milliseconds.
+ * A timer goes into the lowest level whose range covers its deadline. Whenever the lowest level wrapped around,
+ * the next slot of the level above is cascaded, its timers are distributed over the levels below.
+ * Scheduling, cancelling and expiring a timer are constant time, no matter how many connections are open.
+ * timeout() tells the event loop how long it may wait: until the first used slot of the lowest level or, if that
+ * level is empty, until the next cascade which brings a timer closer.
+ * USAGE: schedule(timer, deadline), wait at most timeout(now) milliseconds, advance(now, expired).
+ */
+class TimerWheel
+{
+	public:
+		TimerWheel();
+		~TimerWheel();
+
+		static unsigned long	now();
+
+		void	schedule(Timer &timer, unsigned long deadline);
+		void	cancel(Timer &timer);
+		void	advance(unsigned long now, std::vector<Timer *> &expired);
+		int		timeout(unsigned long now) const;
+		size_t	size() const;
+
+	private:
+		TimerWheel(const TimerWheel &src);
+		TimerWheel &operator=(const TimerWheel &rhs);
+
+		void	link(Timer &timer, unsigned long tick);
+		void	cascade(int level);
+
+		Timer			*_slots[TIMER_LEVELS][TIMER_SLOTS];
+		unsigned long	_current; // the next tick to expire, every earlier tick is done
+		size_t			_size;
+};
+
+#endif
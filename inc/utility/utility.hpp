@@ -57,14 +57,12 @@ bool keyExistsInEachLocationBlock(std::vector<ServerBlock> &serverBlocks, Config
 bool checkIfCgiExecutableAndFileEndingAreSet(std::vector<ServerBlock> &serverBlocks);
 std::string remove_dot_if_first_character_is_dot(std::string to_edit);
 int is_valid_fd(int fd);
-int send_server_unavailable(int forward, ServerBlock serverblock);
-std::string get_file_content_cached(std::string path);
+int send_server_unavailable(int forward, const ServerBlock &serverblock);
 int stoi_replacement( std::string s );
 int kill_with_error(int pid);
 std::string lower_str_ret(std::string str);
 void removeDoubleSlashesInUrl(std::string &url);
 bool keyExistsOrAlternativeInEachLocationBlock(std::vector<ServerBlock> &serverBlocks, ConfigurationKeyType keyType, ConfigurationKeyType alternativeKeyType);
-std::string get_first_location_in_path(const std::string path);
 
 /**
  * @brief converts any type into a string
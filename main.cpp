@@ -1,9 +1,12 @@
 #include "inc/config_file/ConfigFileParsing.hpp"
 #include "inc/configuration_key/ConfigurationKey.hpp"
 #include "inc/configuration_key/ServerBlock.hpp"
+#include "inc/configuration_key/ConfigSnapshot.hpp"
 #include "inc/debugger/DebuggerPrinter.hpp"
 #include "inc/http/Response.hpp"
 #include "inc/network/ServerSocket.hpp"
+#include "inc/network/Master.hpp"
+#include "inc/network/BinaryUpgrade.hpp"
 #include "inc/utility/utility.hpp"
 
 
@@ -29,6 +32,7 @@ int main(int argc, char **argv)
 {
 	USE_DEBUGGER;
 	if (!check_arguments_and_filename(argc, argv)) return (1);
+	BinaryUpgrade::getInstance().remember(argv); // SIGUSR2 starts the binary again with the same arguments
 
 	ConfigFileParsing *configurationFileParsing = new ConfigFileParsing();
 	std::string file_content;
@@ -46,10 +50,20 @@ int main(int argc, char **argv)
 	}
 
 	try {
-		ServerSocket server(configurationFileParsing->serverBlocks[0], *configurationFileParsing, INADDR_ANY);
+		ConfigSnapshot config(*configurationFileParsing, argc == 1 ? "./conf/webserv.conf" : argv[1]);
+		int workers = config.workerProcesses();
+		if (workers > 1) // one event loop per worker process, the master only supervises them
+		{
+			Master master(config, INADDR_ANY, workers);
+			master.run();
+		}
+		else
+			ServerSocket server(config, INADDR_ANY);
 	} catch (int e) {
 		// print exception information
 		std::cout << "Something went wrong with error code " << e << std::endl;
+	} catch (const std::exception& e) {
+		std::cout << R << "Something went wrong: " << Reset << e.what() << std::endl;
 	}
 
 	delete configurationFileParsing;
@@ -9,11 +9,17 @@
 ConfigFileParsing::ConfigFileParsing()
 {
 	this->isCurrentlyInLocationBlock = false;
+	this->isCurrentlyInServerBlock = false;
+	this->server_bracket_counter = 0;
+	this->currentServerIndex = -1;
 }
 
 ConfigFileParsing::ConfigFileParsing( const ConfigFileParsing &src )
 {
 	this->isCurrentlyInLocationBlock = src.isCurrentlyInLocationBlock;
+	this->isCurrentlyInServerBlock = src.isCurrentlyInServerBlock;
+	this->server_bracket_counter = src.server_bracket_counter;
+	this->currentServerIndex = src.currentServerIndex;
 	this->serverBlocks = src.serverBlocks;
 }
 
@@ -26,6 +32,9 @@ ConfigFileParsing & ConfigFileParsing::operator = (const ConfigFileParsing &src)
 	(void) src;
 	serverBlocks = src.serverBlocks;
 	isCurrentlyInLocationBlock = src.isCurrentlyInLocationBlock;
+	isCurrentlyInServerBlock = src.isCurrentlyInServerBlock;
+	server_bracket_counter = src.server_bracket_counter;
+	currentServerIndex = src.currentServerIndex;
 	return (*this);
 }
 
@@ -53,6 +62,38 @@ bool ConfigFileParsing::validationDuplicationCheck() {
 		debugger.error("Configuration file has duplicate post_max_body_size.");
 		throw InvalidConfigurationFile();
 	}
+	if (!checkIfKeyIsUniqueInEachServerBlock(serverBlocks, WORKER_PROCESSES)) {
+		debugger.error("Configuration file has duplicate worker_processes.");
+		throw InvalidConfigurationFile();
+	}
+	if (!checkIfKeyIsUniqueInEachServerBlock(serverBlocks, KEEPALIVE_TIMEOUT)) {
+		debugger.error("Configuration file has duplicate keepalive_timeout.");
+		throw InvalidConfigurationFile();
+	}
+	if (!checkIfKeyIsUniqueInEachServerBlock(serverBlocks, KEEPALIVE_REQUESTS)) {
+		debugger.error("Configuration file has duplicate keepalive_requests.");
+		throw InvalidConfigurationFile();
+	}
+	if (!checkIfKeyIsUniqueInEachServerBlock(serverBlocks, CLIENT_HEADER_TIMEOUT)) {
+		debugger.error("Configuration file has duplicate client_header_timeout.");
+		throw InvalidConfigurationFile();
+	}
+	if (!checkIfKeyIsUniqueInEachServerBlock(serverBlocks, CLIENT_BODY_TIMEOUT)) {
+		debugger.error("Configuration file has duplicate client_body_timeout.");
+		throw InvalidConfigurationFile();
+	}
+	if (!checkIfKeyIsUniqueInEachServerBlock(serverBlocks, SEND_TIMEOUT)) {
+		debugger.error("Configuration file has duplicate send_timeout.");
+		throw InvalidConfigurationFile();
+	}
+	if (!checkIfKeyIsUniqueInEachServerBlock(serverBlocks, FILE_CACHE_SIZE)) {
+		debugger.error("Configuration file has duplicate file_cache_size.");
+		throw InvalidConfigurationFile();
+	}
+	if (!checkIfKeyIsUniqueInEachServerBlock(serverBlocks, FILE_CACHE_CHECK_INTERVAL)) {
+		debugger.error("Configuration file has duplicate file_cache_check_interval.");
+		throw InvalidConfigurationFile();
+	}
 	return true;
 }
 
@@ -116,7 +157,11 @@ bool ConfigFileParsing::parseConfigFile( std::string &file_content ) {
 		return false;
 	}
 	determineConfigurationKeys(file_content);
-	return validateConfiguration();
+	if (!validateConfiguration())
+		return false;
+	for (size_t i = 0; i < this->serverBlocks.size(); i++)
+		this->serverBlocks[i].renderErrorPages();
+	return true;
 }
 
 /**
@@ -182,6 +227,19 @@ void ConfigFileParsing::addConfigurationKeyToLocation( ConfigurationKey &key, Co
 		key.cgi_fileending = trim_whitespaces(keyToAdd.cgi_fileending);
 		addConfigurationKeyTypeToLocation(CGI_FILEENDING, key);
 	}
+	else if (keyToAdd.configurationType == FASTCGI_PASS) {
+		key.fastcgi_pass = keyToAdd.fastcgi_pass;
+		addConfigurationKeyTypeToLocation(FASTCGI_PASS, key);
+	}
+	else if (keyToAdd.configurationType == CGI_HELPERS) {
+		key.cgi_helpers_min = keyToAdd.cgi_helpers_min;
+		key.cgi_helpers_max = keyToAdd.cgi_helpers_max;
+		addConfigurationKeyTypeToLocation(CGI_HELPERS, key);
+	}
+	else if (keyToAdd.configurationType == CGI_HELPER_REQUESTS) {
+		key.cgi_helper_requests = keyToAdd.cgi_helper_requests;
+		addConfigurationKeyTypeToLocation(CGI_HELPER_REQUESTS, key);
+	}
 	else if (keyToAdd.configurationType == DIRECTORY_LISTING) {
 		key.directory_listing = keyToAdd.directory_listing;
 		addConfigurationKeyTypeToLocation(DIRECTORY_LISTING, key);
@@ -206,8 +264,7 @@ void ConfigFileParsing::addConfigurationKeyToLocation( ConfigurationKey &key, Co
 void ConfigFileParsing::addConfigurationKeyToCurrentServerBlock( ConfigurationKey &key )
 {
 	USE_DEBUGGER;
-	int static currentServerIndex = -1;
-	
+
 	if (this->isCurrentlyInLocationBlock && this->isCurrentlyInServerBlock) {
 		this->addConfigurationKeyToLocation(this->serverBlocks[currentServerIndex].configurationKeys.back(), key);
 		return;
@@ -361,6 +418,51 @@ std::vector<unsigned int> ConfigFileParsing::getAllServerPortsFromAllBlocks() {
 	return ports;
 }
 
+/**
+ * @brief Returns the amount of worker processes to start.
+ * The worker processes are shared by all server blocks, so the first server block defining worker_processes wins.
+ * @return int 1 if no server block defines it
+ */
+int ConfigFileParsing::getWorkerProcesses()
+{
+	for (size_t i = 0; i < this->serverBlocks.size(); i++) {
+		std::vector<ConfigurationKey> keys = this->serverBlocks[i].getConfigurationKeysWithType(WORKER_PROCESSES);
+		if (!keys.empty())
+			return keys.front().worker_processes;
+	}
+	return 1;
+}
+
+/**
+ * @brief Returns the bytes of static files the FileCache of a worker may keep in memory.
+ * The cache is shared by all server blocks, so the first server block defining file_cache_size wins.
+ * @return size_t DEFAULT_FILE_CACHE_SIZE megabyte if no server block defines it
+ */
+size_t ConfigFileParsing::getFileCacheSize()
+{
+	for (size_t i = 0; i < this->serverBlocks.size(); i++) {
+		std::vector<ConfigurationKey> keys = this->serverBlocks[i].getConfigurationKeysWithType(FILE_CACHE_SIZE);
+		if (!keys.empty())
+			return (size_t) keys.front().file_cache_size * 1000000;
+	}
+	return (size_t) DEFAULT_FILE_CACHE_SIZE * 1000000;
+}
+
+/**
+ * @brief Returns the seconds a cached file is served without checking it on disk.
+ * The first server block defining file_cache_check_interval wins.
+ * @return int DEFAULT_FILE_CACHE_CHECK_INTERVAL if no server block defines it
+ */
+int ConfigFileParsing::getFileCacheCheckInterval()
+{
+	for (size_t i = 0; i < this->serverBlocks.size(); i++) {
+		std::vector<ConfigurationKey> keys = this->serverBlocks[i].getConfigurationKeysWithType(FILE_CACHE_CHECK_INTERVAL);
+		if (!keys.empty())
+			return keys.front().file_cache_check_interval;
+	}
+	return DEFAULT_FILE_CACHE_CHECK_INTERVAL;
+}
+
 /**
  * @brief Get the Server Block with a requested server name and a requested server port
  * 
@@ -77,7 +77,7 @@ bool checkIfKeyIsUniqueInEachServerBlock(std::vector<ServerBlock> &serverBlocks,
 }
 
 /**
- * @brief Check that every location block with a cgi_executable has a cgi_fileending and vice versa in a location block
+ * @brief Check that every location block with a cgi_executable (or fastcgi_pass) has a cgi_fileending and vice versa in a location block
  * 
  * @param serverBlocks
  */
@@ -92,8 +92,8 @@ bool checkIfCgiExecutableAndFileEndingAreSet(std::vector<ServerBlock> &serverBlo
 		// Iterate over every location block
 		for (locationBlocksInServerBlock.begin(), locationBlocksInServerBlock.end(); j != locationBlocksInServerBlock.end(); ++j) {
 			ConfigurationKey locationBlock = *j;
-			// either cgi_path and cgi_fileending are set or none of them are set
-			if (locationBlock.cgi_path.empty() != locationBlock.cgi_fileending.empty()) {
+			// either cgi_path (or fastcgi_pass) and cgi_fileending are set or none of them are set
+			if ((locationBlock.cgi_path.empty() && locationBlock.fastcgi_pass.empty()) != locationBlock.cgi_fileending.empty()) {
 				return false;
 			}
 		}
@@ -0,0 +1,78 @@
+#include "../../inc/configuration_key/ConfigSnapshot.hpp"
+#include "../../inc/utility/utility.hpp"
+
+ConfigSnapshot::ConfigSnapshot() : _block(NULL)
+{
+}
+
+/**
+ * @brief Compiles the parsed configuration, configFile is not used afterwards
+ * @param path the file configFile was parsed from
+ */
+ConfigSnapshot::ConfigSnapshot(ConfigFileParsing &configFile, const std::string &path) : _block(new Block)
+{
+	_block->refs = 1;
+	_block->path = path;
+	_block->serverBlocks = configFile.serverBlocks;
+	_block->routes.compile(_block->serverBlocks);
+	_block->ports = getAllServerPortsFromAllServerBlocks(_block->serverBlocks);
+	_block->fileCacheSize = configFile.getFileCacheSize();
+	_block->fileCacheCheckInterval = configFile.getFileCacheCheckInterval();
+	_block->workerProcesses = configFile.getWorkerProcesses();
+}
+
+ConfigSnapshot::ConfigSnapshot(const ConfigSnapshot &src) : _block(src._block)
+{
+	if (_block)
+		_block->refs++;
+}
+
+ConfigSnapshot &ConfigSnapshot::operator=(const ConfigSnapshot &src)
+{
+	if (_block == src._block)
+		return *this;
+	release();
+	_block = src._block;
+	if (_block)
+		_block->refs++;
+	return *this;
+}
+
+ConfigSnapshot::~ConfigSnapshot()
+{
+	release();
+}
+
+/**
+ * @brief Parses and validates the configuration file at path and compiles it
+ * @throws InvalidConfigurationFile (or another std::exception) if the file is not a valid configuration
+ */
+ConfigSnapshot	ConfigSnapshot::load(const std::string &path)
+{
+	ConfigFileParsing	configFile;
+	std::string			content = get_file_content(path);
+
+	if (!configFile.parseConfigFile(content))
+		throw InvalidConfigurationFile();
+	return ConfigSnapshot(configFile, path);
+}
+
+/**
+ * @brief Drops the reference, the last one frees the configuration
+ */
+void	ConfigSnapshot::release()
+{
+	if (_block && !--_block->refs)
+		delete _block;
+	_block = NULL;
+}
+
+bool								ConfigSnapshot::empty() const					{ return !_block; }
+const std::string					&ConfigSnapshot::path() const					{ return _block->path; }
+const std::vector<ServerBlock>		&ConfigSnapshot::serverBlocks() const			{ return _block->serverBlocks; }
+const ServerBlock					&ConfigSnapshot::defaultServerBlock() const		{ return _block->routes.defaultServer().block; }
+const RoutingTable					&ConfigSnapshot::routes() const					{ return _block->routes; }
+const std::vector<unsigned int>		&ConfigSnapshot::ports() const					{ return _block->ports; }
+size_t								ConfigSnapshot::fileCacheSize() const			{ return _block->fileCacheSize; }
+int									ConfigSnapshot::fileCacheCheckInterval() const	{ return _block->fileCacheCheckInterval; }
+int									ConfigSnapshot::workerProcesses() const			{ return _block->workerProcesses; }
@@ -2,6 +2,8 @@
 #include "../../inc/debugger/DebuggerPrinter.hpp"
 #include "../../inc/utility/colors.hpp"
 #include "../../inc/utility/utility.hpp"
+#include "../../inc/http/FastCgi.hpp"
+#include <regex.h>
 
 
 /**
@@ -26,6 +28,7 @@ ConfigurationKey::ConfigurationKey( const ConfigurationKey &src ) {
 	this->server_names = src.server_names;
 	this->root = src.root;
 	this->location = src.location;
+	this->location_match = src.location_match;
 	this->indexes = src.indexes;
 	this->methods = src.methods;
 	this->allowedMethods = src.allowedMethods;
@@ -34,8 +37,20 @@ ConfigurationKey::ConfigurationKey( const ConfigurationKey &src ) {
 	this->raw_input = src.raw_input;
 	this->cgi_path = src.cgi_path;
 	this->cgi_fileending = src.cgi_fileending;
+	this->fastcgi_pass = src.fastcgi_pass;
+	this->cgi_helpers_min = src.cgi_helpers_min;
+	this->cgi_helpers_max = src.cgi_helpers_max;
+	this->cgi_helper_requests = src.cgi_helper_requests;
 	this->redirection = src.redirection;
 	this->post_max_size = src.post_max_size;
+	this->worker_processes = src.worker_processes;
+	this->keepalive_timeout = src.keepalive_timeout;
+	this->keepalive_requests = src.keepalive_requests;
+	this->client_header_timeout = src.client_header_timeout;
+	this->client_body_timeout = src.client_body_timeout;
+	this->send_timeout = src.send_timeout;
+	this->file_cache_size = src.file_cache_size;
+	this->file_cache_check_interval = src.file_cache_check_interval;
 	this->nestedConfigurationKeyTypesinLocationBlock = src.nestedConfigurationKeyTypesinLocationBlock;
 	this->directory_listing = src.directory_listing;
 	this->not_found_error_page_path = src.not_found_error_page_path;
@@ -67,6 +82,19 @@ ConfigurationKey::ConfigurationKey(std::string key, std::string value, bool loca
 	this->isCurrentlyParsingLocationBlock = location_block;
 	this->current_line = current_line;
 	this->directory_listing = false;
+	this->post_max_size = 0;
+	this->worker_processes = 1;
+	this->keepalive_timeout = DEFAULT_KEEPALIVE_TIMEOUT;
+	this->keepalive_requests = DEFAULT_KEEPALIVE_REQUESTS;
+	this->client_header_timeout = DEFAULT_CLIENT_HEADER_TIMEOUT;
+	this->client_body_timeout = DEFAULT_CLIENT_BODY_TIMEOUT;
+	this->send_timeout = DEFAULT_SEND_TIMEOUT;
+	this->file_cache_size = DEFAULT_FILE_CACHE_SIZE;
+	this->file_cache_check_interval = DEFAULT_FILE_CACHE_CHECK_INTERVAL;
+	this->cgi_helpers_min = 0;
+	this->cgi_helpers_max = 0;
+	this->cgi_helper_requests = DEFAULT_CGI_HELPER_REQUESTS;
+	this->location_match = LOCATION_PREFIX;
 	this->raw_input = raw_input;
 	DebuggerPrinter debugger = debugger.getInstance();
 	if (key.empty () || value.empty()) {
@@ -118,6 +146,21 @@ ConfigurationKeyType ConfigurationKey::detectLocationKeyConfiguration(internal_k
 		debugger.info("Detected CGI FILE ENDING key type.");
 		return CGI_FILEENDING;
 	}
+	if (this->isFastCgiPassKeyType(raw))
+	{
+		debugger.info("Detected FASTCGI PASS key type.");
+		return FASTCGI_PASS;
+	}
+	if (this->isCgiHelpersKeyType(raw))
+	{
+		debugger.info("Detected CGI HELPERS key type.");
+		return CGI_HELPERS;
+	}
+	if (this->isCgiHelperRequestsKeyType(raw))
+	{
+		debugger.info("Detected CGI HELPER REQUESTS key type.");
+		return CGI_HELPER_REQUESTS;
+	}
 	if (this->isRedirectionKeyType(raw))
 	{
 		debugger.info("Detected REDIRECTION key type.");
@@ -172,6 +215,67 @@ bool ConfigurationKey::isCgiExecutableKeyType(internal_keyvalue raw)
 	return false;
 }
 
+/**
+ * @brief Checks if the key is a fastcgi_pass key type. Sets the address of the FastCGI server.
+ * Accepts unix:/path/to/socket or ip:port (localhost:port as well).
+ * 
+ * @param raw 
+ * @return true 
+ * @return false 
+ */
+bool ConfigurationKey::isFastCgiPassKeyType(internal_keyvalue raw)
+{
+	USE_DEBUGGER;
+	if (raw.first != KEY_FASTCGI_PASS || raw.second.empty())
+		return false;
+	if (!FastCgiPool::isValidAddress(trim_whitespaces(raw.second)))
+		throwInvalidConfigurationFileExceptionWithMessage("Invalid fastcgi_pass. Use unix:/path/to/socket or ip:port.");
+	this->fastcgi_pass = trim_whitespaces(raw.second);
+	return true;
+}
+
+/**
+ * @brief Checks if the key is a cgi helpers key type. Sets the size of the helper pool of the cgi_path.
+ * - accepts two numbers "min max" between 0 and MAXIMUM_CGI_HELPERS, max at least 1 and not below min
+ *
+ * @param raw
+ * @return true
+ * @return false
+ */
+bool ConfigurationKey::isCgiHelpersKeyType(internal_keyvalue raw)
+{
+	if (raw.first != KEY_CGI_HELPERS || raw.second.empty())
+		return false;
+	std::string value = trim_whitespaces(raw.second);
+	std::vector<std::string> values = split_on_delimiter(value, ' ');
+	if (values.size() != 2)
+		throwInvalidConfigurationFileExceptionWithMessage("Invalid cgi_helpers. Use cgi_helpers <min> <max>.");
+	validateNumberInRange(values[0], 0, MAXIMUM_CGI_HELPERS);
+	validateNumberInRange(values[1], 1, MAXIMUM_CGI_HELPERS);
+	this->cgi_helpers_min = stoi_replacement(trim_whitespaces(values[0]));
+	this->cgi_helpers_max = stoi_replacement(trim_whitespaces(values[1]));
+	if (this->cgi_helpers_min > this->cgi_helpers_max)
+		throwInvalidConfigurationFileExceptionWithMessage("Invalid cgi_helpers. min has to be smaller than max.");
+	return true;
+}
+
+/**
+ * @brief Checks if the key is a cgi helper requests key type. Sets the amount of scripts a helper starts.
+ * - accepts a number between 1 and MAXIMUM_CGI_HELPER_REQUESTS
+ *
+ * @param raw
+ * @return true
+ * @return false
+ */
+bool ConfigurationKey::isCgiHelperRequestsKeyType(internal_keyvalue raw)
+{
+	if (raw.first != KEY_CGI_HELPER_REQUESTS || raw.second.empty())
+		return false;
+	validateNumberInRange(raw.second, 1, MAXIMUM_CGI_HELPER_REQUESTS);
+	this->cgi_helper_requests = stoi_replacement(trim_whitespaces(raw.second));
+	return true;
+}
+
 /**
  * @brief Validates Redirection value
  * A redirection key type is only accepted if the redirection is a valid url or a relative path
@@ -306,6 +410,172 @@ bool ConfigurationKey::isPostMaxSizeType(internal_keyvalue raw)
 	return false;
 }
 
+/**
+ * @brief Validates a plain positive number (no unit) which has to be between min and max (both included).
+ * Throws an invalid configuration file exception otherwise.
+ * @param to_validate
+ * @param min
+ * @param max
+ * @return true
+ */
+bool ConfigurationKey::validateNumberInRange(std::string to_validate, int min, int max)
+{
+	to_validate = trim_whitespaces(to_validate);
+	if (to_validate.empty() || !isnumberstring(to_validate) || to_validate.length() > 9)
+		throwInvalidConfigurationFileExceptionWithMessage("Invalid number " + to_validate + ". Only digits allowed.");
+	int number = stoi_replacement(to_validate);
+	if (number < min || number > max)
+		throwInvalidConfigurationFileExceptionWithMessage("Number needs to be between " + to_str(min) + " and " + to_str(max) + ".");
+	return true;
+}
+
+/**
+ * @brief Checks if the key is a worker processes key type. Sets the amount of worker processes.
+ * - accepts a number between 1 and MAXIMUM_WORKER_PROCESSES
+ * - accepts auto, which starts one worker per online cpu core
+ *
+ * @param raw
+ * @return true
+ * @return false
+ */
+bool ConfigurationKey::isWorkerProcessesKeyType(internal_keyvalue raw)
+{
+	if (raw.first != KEY_WORKER_PROCESSES || raw.second.empty())
+		return false;
+	if (trim_whitespaces(raw.second) == "auto")
+	{
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		this->worker_processes = std::max(1L, std::min(cores, (long) MAXIMUM_WORKER_PROCESSES));
+		return true;
+	}
+	validateNumberInRange(raw.second, 1, MAXIMUM_WORKER_PROCESSES);
+	this->worker_processes = stoi_replacement(trim_whitespaces(raw.second));
+	return true;
+}
+
+/**
+ * @brief Checks if the key is a keepalive timeout key type. Sets the seconds an idle connection is kept open.
+ * - accepts a number between 0 and MAXIMUM_KEEPALIVE_TIMEOUT, 0 closes every connection after one response
+ *
+ * @param raw
+ * @return true
+ * @return false
+ */
+bool ConfigurationKey::isKeepAliveTimeoutKeyType(internal_keyvalue raw)
+{
+	if (raw.first != KEY_KEEPALIVE_TIMEOUT || raw.second.empty())
+		return false;
+	validateNumberInRange(raw.second, 0, MAXIMUM_KEEPALIVE_TIMEOUT);
+	this->keepalive_timeout = stoi_replacement(trim_whitespaces(raw.second));
+	return true;
+}
+
+/**
+ * @brief Checks if the key is a keepalive requests key type. Sets the amount of requests served on one connection.
+ * - accepts a number between 1 and MAXIMUM_KEEPALIVE_REQUESTS
+ *
+ * @param raw
+ * @return true
+ * @return false
+ */
+bool ConfigurationKey::isKeepAliveRequestsKeyType(internal_keyvalue raw)
+{
+	if (raw.first != KEY_KEEPALIVE_REQUESTS || raw.second.empty())
+		return false;
+	validateNumberInRange(raw.second, 1, MAXIMUM_KEEPALIVE_REQUESTS);
+	this->keepalive_requests = stoi_replacement(trim_whitespaces(raw.second));
+	return true;
+}
+
+/**
+ * @brief Checks if the key is a client header timeout key type. Sets the seconds a client has to send the head of a request.
+ * - accepts a number between 1 and MAXIMUM_CONNECTION_TIMEOUT
+ *
+ * @param raw
+ * @return true
+ * @return false
+ */
+bool ConfigurationKey::isClientHeaderTimeoutKeyType(internal_keyvalue raw)
+{
+	if (raw.first != KEY_CLIENT_HEADER_TIMEOUT || raw.second.empty())
+		return false;
+	validateNumberInRange(raw.second, 1, MAXIMUM_CONNECTION_TIMEOUT);
+	this->client_header_timeout = stoi_replacement(trim_whitespaces(raw.second));
+	return true;
+}
+
+/**
+ * @brief Checks if the key is a client body timeout key type. Sets the seconds a client may pause while it sends a body.
+ * - accepts a number between 1 and MAXIMUM_CONNECTION_TIMEOUT
+ *
+ * @param raw
+ * @return true
+ * @return false
+ */
+bool ConfigurationKey::isClientBodyTimeoutKeyType(internal_keyvalue raw)
+{
+	if (raw.first != KEY_CLIENT_BODY_TIMEOUT || raw.second.empty())
+		return false;
+	validateNumberInRange(raw.second, 1, MAXIMUM_CONNECTION_TIMEOUT);
+	this->client_body_timeout = stoi_replacement(trim_whitespaces(raw.second));
+	return true;
+}
+
+/**
+ * @brief Checks if the key is a send timeout key type. Sets the seconds a client may stop taking the response.
+ * - accepts a number between 1 and MAXIMUM_CONNECTION_TIMEOUT
+ *
+ * @param raw
+ * @return true
+ * @return false
+ */
+bool ConfigurationKey::isSendTimeoutKeyType(internal_keyvalue raw)
+{
+	if (raw.first != KEY_SEND_TIMEOUT || raw.second.empty())
+		return false;
+	validateNumberInRange(raw.second, 1, MAXIMUM_CONNECTION_TIMEOUT);
+	this->send_timeout = stoi_replacement(trim_whitespaces(raw.second));
+	return true;
+}
+
+/**
+ * @brief Checks if the key is a file cache size key type. Sets the megabyte of static files kept in memory.
+ * - accepts a number between 0 and MAXIMUM_FILE_CACHE_SIZE with an M at the end, 0M disables the cache
+ *
+ * @param raw
+ * @return true
+ * @return false
+ */
+bool ConfigurationKey::isFileCacheSizeKeyType(internal_keyvalue raw)
+{
+	if (raw.first != KEY_FILE_CACHE_SIZE || raw.second.empty())
+		return false;
+	std::string value = trim_whitespaces(raw.second);
+	if (value[value.length() - 1] != 'M')
+		throwInvalidConfigurationFileExceptionWithMessage("Invalid file cache size. Has to end with M.");
+	value = value.substr(0, value.length() - 1);
+	validateNumberInRange(value, 0, MAXIMUM_FILE_CACHE_SIZE);
+	this->file_cache_size = stoi_replacement(value);
+	return true;
+}
+
+/**
+ * @brief Checks if the key is a file cache check interval key type. Sets the seconds between two checks of a cached file.
+ * - accepts a number between 0 and MAXIMUM_FILE_CACHE_CHECK_INTERVAL, 0 checks the file on every request
+ *
+ * @param raw
+ * @return true
+ * @return false
+ */
+bool ConfigurationKey::isFileCacheCheckIntervalKeyType(internal_keyvalue raw)
+{
+	if (raw.first != KEY_FILE_CACHE_CHECK_INTERVAL || raw.second.empty())
+		return false;
+	validateNumberInRange(raw.second, 0, MAXIMUM_FILE_CACHE_CHECK_INTERVAL);
+	this->file_cache_check_interval = stoi_replacement(trim_whitespaces(raw.second));
+	return true;
+}
+
 /**
  * @brief Checks if the key is a CGI File endinng key type. Sets the cgi file ending value.
  * 
@@ -398,6 +668,46 @@ ConfigurationKeyType ConfigurationKey::detectConfigurationType(internal_keyvalue
 		debugger.info("Detected CGI FILE ENDING key type in server block.");
 		return CGI_FILEENDING;
 	}
+	if (this->isWorkerProcessesKeyType(raw))
+	{
+		debugger.info("Detected WORKER PROCESSES key type in server block.");
+		return WORKER_PROCESSES;
+	}
+	if (this->isKeepAliveTimeoutKeyType(raw))
+	{
+		debugger.info("Detected KEEPALIVE TIMEOUT key type in server block.");
+		return KEEPALIVE_TIMEOUT;
+	}
+	if (this->isKeepAliveRequestsKeyType(raw))
+	{
+		debugger.info("Detected KEEPALIVE REQUESTS key type in server block.");
+		return KEEPALIVE_REQUESTS;
+	}
+	if (this->isClientHeaderTimeoutKeyType(raw))
+	{
+		debugger.info("Detected CLIENT HEADER TIMEOUT key type in server block.");
+		return CLIENT_HEADER_TIMEOUT;
+	}
+	if (this->isClientBodyTimeoutKeyType(raw))
+	{
+		debugger.info("Detected CLIENT BODY TIMEOUT key type in server block.");
+		return CLIENT_BODY_TIMEOUT;
+	}
+	if (this->isSendTimeoutKeyType(raw))
+	{
+		debugger.info("Detected SEND TIMEOUT key type in server block.");
+		return SEND_TIMEOUT;
+	}
+	if (this->isFileCacheSizeKeyType(raw))
+	{
+		debugger.info("Detected FILE CACHE SIZE key type in server block.");
+		return FILE_CACHE_SIZE;
+	}
+	if (this->isFileCacheCheckIntervalKeyType(raw))
+	{
+		debugger.info("Detected FILE CACHE CHECK INTERVAL key type in server block.");
+		return FILE_CACHE_CHECK_INTERVAL;
+	}
 	return INVALID;
 }
 
@@ -406,7 +716,8 @@ ConfigurationKeyType ConfigurationKey::detectConfigurationType(internal_keyvalue
  * - isCurrentlyParsingLocationBlock
  * - Will check if the last character in location is a opening bracket
  * - Will remove the last character from location if it is a opening bracket to enable parsing of the location path
- * - Always adds a / at the end of the location path if there is no / present
+ * - Always adds a / at the end of the location path if there is no / present (except for exact locations)
+ * - Reads the modifier in front of the path (=, ^~, ~, ~*) into location_match, a regular expression is kept as written
  */
 bool ConfigurationKey::isLocationKeyType(internal_keyvalue &raw) {
 	if (raw.first == "location" && !raw.second.empty()) {
@@ -416,14 +727,38 @@ bool ConfigurationKey::isLocationKeyType(internal_keyvalue &raw) {
 		}
 		raw.second.erase(raw.second.length() - 1); // delete the last character
 		raw.second = trim_whitespaces(raw.second);
-		// check if a slash is the last character. If not, add one
-		if (raw.second[raw.second.length() - 1] != '/') {
-			raw.second += "/";
+		// a modifier (=, ^~, ~, ~*) is separated from the path by whitespace
+		size_t end = raw.second.find_first_of(" \t");
+		if (end != std::string::npos) {
+			std::string modifier = raw.second.substr(0, end);
+			if (modifier == "=")
+				this->location_match = LOCATION_EXACT;
+			else if (modifier == "^~")
+				this->location_match = LOCATION_PREFIX_NO_REGEX;
+			else if (modifier == "~")
+				this->location_match = LOCATION_REGEX;
+			else if (modifier == "~*")
+				this->location_match = LOCATION_REGEX_CASELESS;
+			else
+				throwInvalidConfigurationFileExceptionWithMessage("Location path cannot contain spaces!");
+			raw.second.erase(0, raw.second.find_first_not_of(" \t", end));
 		}
-		// check there are no forbidden characters in the location path
-		if (raw.second.find_first_of(" ") != std::string::npos) {
+		if (raw.second.empty() || raw.second.find_first_of(" \t") != std::string::npos) {
 			throwInvalidConfigurationFileExceptionWithMessage("Location path cannot contain spaces!");
 		}
+		// a regular expression is kept as it is
+		if (this->location_match == LOCATION_REGEX || this->location_match == LOCATION_REGEX_CASELESS) {
+			if (!validateLocationPattern(raw.second, this->location_match == LOCATION_REGEX_CASELESS))
+				throwInvalidConfigurationFileExceptionWithMessage("Location pattern is not a valid regular expression!");
+			return true;
+		}
+		// check if a slash is the last character. If not, add one. An exact location can also name a file.
+		if (raw.second[raw.second.length() - 1] != '/' && this->location_match != LOCATION_EXACT) {
+			raw.second += "/";
+		}
+		if (raw.second[0] != '/' && this->location_match != LOCATION_PREFIX) {
+			throwInvalidConfigurationFileExceptionWithMessage("Location path has to start with a slash!");
+		}
 		// remove any double slashes in the location path
 		removeDoubleSlashesInUrl(raw.second);
 		return true;
@@ -431,6 +766,19 @@ bool ConfigurationKey::isLocationKeyType(internal_keyvalue &raw) {
 	return false;
 }
 
+/**
+ * @brief Compiles the pattern of a regex location once to find syntax errors while parsing
+ */
+bool ConfigurationKey::validateLocationPattern(std::string pattern, bool caseless)
+{
+	regex_t	compiled;
+
+	if (regcomp(&compiled, pattern.c_str(), REG_EXTENDED | REG_NOSUB | (caseless ? REG_ICASE : 0)))
+		return false;
+	regfree(&compiled);
+	return true;
+}
+
 /**
  * @brief Checks if the key is a root key type. Sets the root value.
  * 
@@ -0,0 +1,380 @@
+#include "../../inc/configuration_key/RoutingTable.hpp"
+#include "../../inc/utility/utility.hpp"
+#include <cctype>
+#include <climits>
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+VirtualServer::VirtualServer() : has_post_max_size(false), post_max_size(ULONG_MAX), keepalive_timeout(DEFAULT_KEEPALIVE_TIMEOUT), keepalive_requests(DEFAULT_KEEPALIVE_REQUESTS),
+	client_header_timeout(DEFAULT_CLIENT_HEADER_TIMEOUT), client_body_timeout(DEFAULT_CLIENT_BODY_TIMEOUT), send_timeout(DEFAULT_SEND_TIMEOUT), _has_any(false)
+{
+	newNode("");
+}
+
+/**
+ * @brief Copies the server, the regex locations are compiled again because a regex_t can not be copied
+ */
+VirtualServer::VirtualServer(const VirtualServer &src) : block(src.block), root(src.root), index(src.index), server_name(src.server_name),
+	cgi_path(src.cgi_path), cgi_fileending(src.cgi_fileending), has_post_max_size(src.has_post_max_size), post_max_size(src.post_max_size),
+	keepalive_timeout(src.keepalive_timeout), keepalive_requests(src.keepalive_requests),
+	client_header_timeout(src.client_header_timeout), client_body_timeout(src.client_body_timeout), send_timeout(src.send_timeout),
+	_locations(src._locations), _nodes(src._nodes), _patterns(src._patterns), _has_any(false)
+{
+	compilePatterns();
+}
+
+VirtualServer &VirtualServer::operator=(const VirtualServer &rhs)
+{
+	if (this == &rhs)
+		return *this;
+	freePatterns();
+	block = rhs.block;
+	root = rhs.root;
+	index = rhs.index;
+	server_name = rhs.server_name;
+	cgi_path = rhs.cgi_path;
+	cgi_fileending = rhs.cgi_fileending;
+	has_post_max_size = rhs.has_post_max_size;
+	post_max_size = rhs.post_max_size;
+	keepalive_timeout = rhs.keepalive_timeout;
+	keepalive_requests = rhs.keepalive_requests;
+	client_header_timeout = rhs.client_header_timeout;
+	client_body_timeout = rhs.client_body_timeout;
+	send_timeout = rhs.send_timeout;
+	_locations = rhs._locations;
+	_nodes = rhs._nodes;
+	_patterns = rhs._patterns;
+	compilePatterns();
+	return *this;
+}
+
+VirtualServer::~VirtualServer()
+{
+	freePatterns();
+}
+
+/**
+ * @brief Resolves the values of the server block and builds the radix tree of its locations.
+ * Two locations with the same path keep the first one, like the linear search did.
+ */
+void	VirtualServer::compile(const ServerBlock &src)
+{
+	block = src;
+	std::vector<ConfigurationKey>	roots = block.getConfigurationKeysWithType(ROOT); // no assignments, ConfigurationKey::operator= does not copy
+	std::vector<ConfigurationKey>	indexes = block.getConfigurationKeysWithType(INDEX);
+	std::vector<ConfigurationKey>	names = block.getConfigurationKeysWithType(SERVER_NAME);
+	std::vector<ConfigurationKey>	keys = block.getConfigurationKeysWithType(LOCATION);
+	if (!roots.empty())
+		root = roots.front().root;
+	if (!indexes.empty() && !indexes.front().indexes.empty())
+		index = indexes.front().indexes.front();
+	if (!names.empty() && !names.front().server_names.empty())
+		server_name = names.front().server_names.front();
+	cgi_path = block.getCgiPath();
+	cgi_fileending = block.getCgiFileEnding();
+	has_post_max_size = !block.getConfigurationKeysWithType(POST_MAX_SIZE).empty();
+	post_max_size = block.getPostMaxSize();
+	keepalive_timeout = block.getKeepAliveTimeout();
+	keepalive_requests = block.getKeepAliveRequests();
+	client_header_timeout = block.getClientHeaderTimeout();
+	client_body_timeout = block.getClientBodyTimeout();
+	send_timeout = block.getSendTimeout();
+
+	freePatterns();
+	_patterns.clear();
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		RouteLocation	location;
+		location.path = keys[i].value;
+		location.match = keys[i].location_match;
+		location.root = keys[i].root;
+		if (!keys[i].indexes.empty())
+			location.index = keys[i].indexes.front();
+		location.cgi_path = keys[i].cgi_path;
+		location.cgi_fileending = keys[i].cgi_fileending;
+		location.fastcgi_pass = keys[i].fastcgi_pass;
+		location.redirection = keys[i].redirection;
+		location.methods = keys[i].allowedMethods;
+		location.directory_listing = keys[i].directory_listing;
+		_locations.push_back(location);
+		if (location.match == LOCATION_REGEX || location.match == LOCATION_REGEX_CASELESS)
+			_patterns.push_back(_locations.size() - 1);
+		else
+			insert(location.path, _locations.size() - 1, location.match == LOCATION_EXACT);
+	}
+	compilePatterns();
+}
+
+/**
+ * @brief Returns the location serving path (the request path without query, starting with a slash)
+ * @param matched set to the length of the beginning of path the root of the location stands for:
+ * the path of a prefix location, the directory of an exact location and only the first slash for a regex location
+ * @return NULL if no location matches
+ */
+const RouteLocation	*VirtualServer::matchLocation(const std::string &path, size_t &matched) const
+{
+	int		node = 0;
+	size_t	position = 0;
+	int		prefix = _nodes[0].prefix;
+	size_t	prefix_length = 0;
+	int		exact = -1;
+
+	while (true)
+	{
+		const Node	&current = _nodes[node];
+		// an exact location matches the path, or the path with a slash added like the directories of a request
+		if (current.exact >= 0 && (position == path.size() || (position + 1 == path.size() && path[position] == '/')))
+			exact = current.exact;
+		if (position == path.size())
+			break ;
+		int	next = child(node, path[position]);
+		if (next < 0 || path.compare(position, _nodes[next].label.size(), _nodes[next].label) != 0)
+			break ;
+		position += _nodes[next].label.size();
+		node = next;
+		if (_nodes[node].prefix >= 0)
+		{
+			prefix = _nodes[node].prefix;
+			prefix_length = position;
+		}
+	}
+	if (exact >= 0)
+	{
+		const std::string	&location = _locations[exact].path;
+		matched = location.size() < path.size() ? path.size() : location.rfind('/') + 1;
+		return &_locations[exact];
+	}
+	if ((prefix < 0 || _locations[prefix].match != LOCATION_PREFIX_NO_REGEX) && (!_has_any || regexec(&_any, path.c_str(), 0, NULL, 0) == 0))
+	{
+		for (size_t i = 0; i < _patterns.size(); i++)
+		{
+			if (regexec(&_compiled[i], path.c_str(), 0, NULL, 0) == 0)
+			{
+				matched = 1;
+				return &_locations[_patterns[i]];
+			}
+		}
+	}
+	if (prefix < 0)
+		return NULL;
+	matched = prefix_length;
+	return &_locations[prefix];
+}
+
+int	VirtualServer::newNode(const std::string &label)
+{
+	Node	node;
+
+	node.label = label;
+	node.prefix = -1;
+	node.exact = -1;
+	_nodes.push_back(node);
+	return _nodes.size() - 1;
+}
+
+/**
+ * @brief Returns the child of node whose label starts with c, -1 if there is none (binary search)
+ */
+int	VirtualServer::child(int node, char c) const
+{
+	const std::vector<std::pair<char, int> >	&children = _nodes[node].children;
+	size_t	low = 0;
+	size_t	high = children.size();
+
+	while (low < high)
+	{
+		size_t	middle = (low + high) / 2;
+		if (children[middle].first == c)
+			return children[middle].second;
+		if (children[middle].first < c)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return -1;
+}
+
+void	VirtualServer::link(int node, int next)
+{
+	std::vector<std::pair<char, int> >				&children = _nodes[node].children;
+	std::vector<std::pair<char, int> >::iterator	it = children.begin();
+	char											c = _nodes[next].label[0];
+
+	while (it != children.end() && it->first < c)
+		++it;
+	children.insert(it, std::make_pair(c, next));
+}
+
+/**
+ * @brief Adds path to the radix tree, an edge sharing only the beginning with path is split in two
+ */
+void	VirtualServer::insert(const std::string &path, int location, bool exact)
+{
+	int		node = 0;
+	size_t	position = 0;
+
+	while (position < path.size())
+	{
+		int	next = child(node, path[position]);
+		if (next < 0)
+		{
+			next = newNode(path.substr(position));
+			link(node, next);
+			node = next;
+			break ;
+		}
+		const std::string	label = _nodes[next].label;
+		size_t				common = 0;
+		while (common < label.size() && position + common < path.size() && label[common] == path[position + common])
+			common++;
+		if (common < label.size())
+		{
+			int	tail = newNode(label.substr(common)); // keeps the children and locations of next
+			_nodes[tail].children.swap(_nodes[next].children);
+			_nodes[tail].prefix = _nodes[next].prefix;
+			_nodes[tail].exact = _nodes[next].exact;
+			_nodes[next].label.erase(common);
+			_nodes[next].prefix = -1;
+			_nodes[next].exact = -1;
+			link(next, tail);
+		}
+		node = next;
+		position += common;
+	}
+	int	&slot = exact ? _nodes[node].exact : _nodes[node].prefix;
+	if (slot < 0)
+		slot = location;
+}
+
+/**
+ * @brief Compiles the regex locations, the patterns were checked while parsing the configuration file.
+ * A path matching one of the patterns also matches their caseless alternation, so it can reject a path
+ * for all of them at once. Patterns with back references are not combined, their numbers would change.
+ */
+void	VirtualServer::compilePatterns()
+{
+	std::string	any;
+	bool		combine = _patterns.size() > 1;
+
+	_compiled.resize(_patterns.size());
+	for (size_t i = 0; i < _patterns.size(); i++)
+	{
+		const RouteLocation	&location = _locations[_patterns[i]];
+		int					flags = REG_EXTENDED | REG_NOSUB | (location.match == LOCATION_REGEX_CASELESS ? REG_ICASE : 0);
+		if (regcomp(&_compiled[i], location.path.c_str(), flags))
+			regcomp(&_compiled[i], "a^", REG_EXTENDED | REG_NOSUB); // never matches
+		for (size_t j = location.path.find('\\'); j != std::string::npos; j = location.path.find('\\', j + 2))
+			if (j + 1 < location.path.size() && isdigit(location.path[j + 1]))
+				combine = false;
+		any += (i ? "|(" : "(") + location.path + ")";
+	}
+	_has_any = combine && !regcomp(&_any, any.c_str(), REG_EXTENDED | REG_NOSUB | REG_ICASE);
+}
+
+void	VirtualServer::freePatterns()
+{
+	for (size_t i = 0; i < _compiled.size(); i++)
+		regfree(&_compiled[i]);
+	_compiled.clear();
+	if (_has_any)
+		regfree(&_any);
+	_has_any = false;
+}
+
+RoutingTable::RoutingTable()
+{
+}
+
+RoutingTable::~RoutingTable()
+{
+}
+
+/**
+ * @brief Compiles every server block and the (port, host) entries of their server names
+ */
+void	RoutingTable::compile(const std::vector<ServerBlock> &serverBlocks)
+{
+	std::vector<std::pair<std::string, int> >	owners; // server name -> first server block declaring it
+
+	_servers.clear();
+	_servers.resize(serverBlocks.empty() ? 1 : serverBlocks.size());
+	for (size_t i = 0; i < serverBlocks.size(); i++)
+	{
+		_servers[i].compile(serverBlocks[i]);
+		std::vector<std::string>	names = _servers[i].block.getAllServerNames();
+		for (size_t j = 0; j < names.size(); j++)
+		{
+			size_t	k = 0;
+			while (k < owners.size() && owners[k].first != names[j])
+				k++;
+			if (k == owners.size())
+				owners.push_back(std::make_pair(names[j], (int) i));
+		}
+	}
+
+	size_t	entries = 0;
+	for (size_t k = 0; k < owners.size(); k++)
+		entries += _servers[owners[k].second].block.getAllServerPorts().size();
+	size_t	size = 16;
+	while (size < entries * 2)
+		size *= 2;
+	Slot	empty = {0, 0, "", -1};
+	_slots.assign(size, empty);
+	for (size_t k = 0; k < owners.size(); k++)
+	{
+		std::vector<unsigned int>	ports = _servers[owners[k].second].block.getAllServerPorts();
+		for (size_t p = 0; p < ports.size(); p++)
+			insert(owners[k].first, ports[p], owners[k].second);
+	}
+}
+
+/**
+ * @brief Returns the virtual server for the Host header (without port) and the port of the request
+ */
+const VirtualServer	&RoutingTable::resolve(const std::string &host, unsigned int port) const
+{
+	if (_slots.empty())
+		return _servers[0];
+	unsigned int	h = hash(host, port);
+	size_t			mask = _slots.size() - 1;
+
+	for (size_t i = h & mask; _slots[i].server >= 0; i = (i + 1) & mask)
+		if (_slots[i].hash == h && _slots[i].port == port && _slots[i].host == host)
+			return _servers[_slots[i].server];
+	return _servers[0];
+}
+
+const VirtualServer	&RoutingTable::defaultServer() const	{ return _servers[0]; }
+
+/**
+ * @brief FNV-1a over the host name and the four bytes of the port
+ */
+unsigned int	RoutingTable::hash(const std::string &host, unsigned int port)
+{
+	unsigned int	h = FNV_OFFSET_BASIS;
+
+	for (size_t i = 0; i < host.size(); i++)
+		h = (h ^ (unsigned char) host[i]) * FNV_PRIME;
+	for (int i = 0; i < 4; i++)
+		h = (h ^ ((port >> (i * 8)) & 0xff)) * FNV_PRIME;
+	return h;
+}
+
+void	RoutingTable::insert(const std::string &host, unsigned int port, int server)
+{
+	unsigned int	h = hash(host, port);
+	size_t			mask = _slots.size() - 1;
+	size_t			i = h & mask;
+
+	while (_slots[i].server >= 0)
+	{
+		if (_slots[i].hash == h && _slots[i].port == port && _slots[i].host == host)
+			return ; // the port is listed twice
+		i = (i + 1) & mask;
+	}
+	_slots[i].hash = h;
+	_slots[i].port = port;
+	_slots[i].host = host;
+	_slots[i].server = server;
+}
@@ -1,6 +1,7 @@
 #include "../../inc/configuration_key/ServerBlock.hpp"
 #include "../../inc/debugger/DebuggerPrinter.hpp"
 #include "../../inc/utility/utility.hpp"
+#include "../../inc/http/Response.hpp"
 
 /**
  * Creates Server Block.
@@ -15,6 +16,7 @@ ServerBlock::ServerBlock( const ServerBlock &src )
 {
 	this->configurationKeys = src.configurationKeys;
 	this->serverIndex = src.serverIndex;
+	this->_errorResponses = src._errorResponses;
 }
 
 ServerBlock::~ServerBlock()
@@ -25,6 +27,7 @@ ServerBlock::~ServerBlock()
 ServerBlock & ServerBlock::operator = (const ServerBlock &src) {
 	configurationKeys = src.configurationKeys;
 	serverIndex = src.serverIndex;
+	_errorResponses = src._errorResponses;
 	return (*this);
 }
 
@@ -44,7 +47,7 @@ void ServerBlock::addConfigurationKey(ConfigurationKey &configurationKey) {
  * @brief Get all configuration keys with the requested type
  * @param type type of configuration keys to be returned
  */
-std::vector<ConfigurationKey> ServerBlock::getConfigurationKeysWithType(ConfigurationKeyType type) {
+std::vector<ConfigurationKey> ServerBlock::getConfigurationKeysWithType(ConfigurationKeyType type) const {
 	std::vector<ConfigurationKey> keys;
 	for (int i = 0; i < (int) this->configurationKeys.size(); i++) {
 		if (this->configurationKeys[i].configurationType == type) {
@@ -82,6 +85,84 @@ std::string ServerBlock::getCgiFileEnding() {
 	return remove_dot_if_first_character_is_dot(cgi_fileending);
 }
 
+/**
+ * @brief returns the seconds an idle persistent connection is kept open (0 disables keep-alive)
+ * 
+ * @return int 
+ */
+int ServerBlock::getKeepAliveTimeout() {
+	std::vector<ConfigurationKey> configKeys = this->getConfigurationKeysWithType(KEEPALIVE_TIMEOUT);
+	if (configKeys.size() == 0) {
+		return DEFAULT_KEEPALIVE_TIMEOUT;
+	}
+	return configKeys[0].keepalive_timeout;
+}
+
+/**
+ * @brief returns the maximum amount of requests served on one persistent connection
+ * 
+ * @return int 
+ */
+int ServerBlock::getKeepAliveRequests() {
+	std::vector<ConfigurationKey> configKeys = this->getConfigurationKeysWithType(KEEPALIVE_REQUESTS);
+	if (configKeys.size() == 0) {
+		return DEFAULT_KEEPALIVE_REQUESTS;
+	}
+	return configKeys[0].keepalive_requests;
+}
+
+/**
+ * @brief returns the seconds a client has to send the head of a request
+ * 
+ * @return int 
+ */
+int ServerBlock::getClientHeaderTimeout() {
+	std::vector<ConfigurationKey> configKeys = this->getConfigurationKeysWithType(CLIENT_HEADER_TIMEOUT);
+	if (configKeys.size() == 0) {
+		return DEFAULT_CLIENT_HEADER_TIMEOUT;
+	}
+	return configKeys[0].client_header_timeout;
+}
+
+/**
+ * @brief returns the seconds a client may pause while it sends a request body
+ * 
+ * @return int 
+ */
+int ServerBlock::getClientBodyTimeout() {
+	std::vector<ConfigurationKey> configKeys = this->getConfigurationKeysWithType(CLIENT_BODY_TIMEOUT);
+	if (configKeys.size() == 0) {
+		return DEFAULT_CLIENT_BODY_TIMEOUT;
+	}
+	return configKeys[0].client_body_timeout;
+}
+
+/**
+ * @brief returns the seconds a client may stop taking the response before it is disconnected
+ * 
+ * @return int 
+ */
+int ServerBlock::getSendTimeout() {
+	std::vector<ConfigurationKey> configKeys = this->getConfigurationKeysWithType(SEND_TIMEOUT);
+	if (configKeys.size() == 0) {
+		return DEFAULT_SEND_TIMEOUT;
+	}
+	return configKeys[0].send_timeout;
+}
+
+/**
+ * @brief returns the maximum size of a request body in bytes, post_max_size is given in megabyte
+ * 
+ * @return unsigned long, ULONG_MAX if there is no limit
+ */
+unsigned long ServerBlock::getPostMaxSize() {
+	std::vector<ConfigurationKey> configKeys = this->getConfigurationKeysWithType(POST_MAX_SIZE);
+	if (configKeys.size() == 0) {
+		return ULONG_MAX;
+	}
+	return (unsigned long)configKeys[0].post_max_size * 1000000;
+}
+
 /**
  * Returns all ports in the correct order
  *
@@ -148,7 +229,7 @@ std::vector<std::string> ServerBlock::getAllServerNames() {
  * @param serverBlock
  * @return std::string 
  */
-std::string ServerBlock::getFallbackErrorPageForCode(int statuscode)
+std::string ServerBlock::getFallbackErrorPageForCode(int statuscode) const
 {
 	switch (statuscode)
 	{
@@ -192,7 +273,7 @@ std::string ServerBlock::getFallbackErrorPageForCode(int statuscode)
  * 
  * TODO: Replace GENERAL_ERROR_PAGE with the pages which are not customizable by the user
  */
-std::string ServerBlock::getErrorPagePathForCode(int statuscode)
+std::string ServerBlock::getErrorPagePathForCode(int statuscode) const
 {
 	std::string path_to_file;
 
@@ -233,4 +314,62 @@ std::string ServerBlock::getErrorPagePathForCode(int statuscode)
 		return path_to_file;
 	
 	return getFallbackErrorPageForCode(statuscode);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Renders the complete response for an error code with the error page of this server block
+ */
+SharedBuffer ServerBlock::renderErrorResponse(int statuscode, std::string status_text, bool keep_alive)
+{
+	Response response;
+	response.set_protocol("HTTP/1.1");
+	response.set_status_code(to_str(statuscode));
+	response.set_status_text(status_text);
+	response.set_body(get_file_content(getErrorPagePathForCode(statuscode)));
+	response.set_content_type(response.get_file_format());
+	response.set_connection(keep_alive ? "keep-alive" : "close");
+	response.create_response();
+	std::string raw = response.get_head() + response.get_payload();
+	return SharedBuffer(raw);
+}
+
+/**
+ * @brief Renders the responses of all the errors we answer with an error page.
+ * Called once after the configuration file was parsed, so answering an error does not touch the disk anymore.
+ */
+void ServerBlock::renderErrorPages()
+{
+	static const std::pair<int, const char *> errors[] = {
+		std::make_pair(400, "Bad request"),
+		std::make_pair(404, "Not Found"),
+		std::make_pair(405, "Method not allowed"),
+		std::make_pair(413, "Request too big"),
+		std::make_pair(414, "URI too long"),
+		std::make_pair(431, "Request header fields too large"),
+		std::make_pair(500, "Internal server error"),
+		std::make_pair(501, "Not implemented"),
+		std::make_pair(502, "Bad gateway"),
+		std::make_pair(503, "Service Unavailable"),
+		std::make_pair(504, "Gateway timeout"),
+		std::make_pair(505, "HTTP version not supported")
+	};
+
+	_errorResponses.clear();
+	for (size_t i = 0; i < sizeof(errors) / sizeof(errors[0]); i++)
+	{
+		_errorResponses[std::make_pair(errors[i].first, true)] = renderErrorResponse(errors[i].first, errors[i].second, true);
+		_errorResponses[std::make_pair(errors[i].first, false)] = renderErrorResponse(errors[i].first, errors[i].second, false);
+	}
+}
+
+/**
+ * @brief Returns the pre-rendered response for the error code
+ * @return SharedBuffer empty if there is no pre-rendered response for the code
+ */
+SharedBuffer ServerBlock::getErrorResponse(int statuscode, bool keep_alive) const
+{
+	std::map<std::pair<int, bool>, SharedBuffer>::const_iterator it = _errorResponses.find(std::make_pair(statuscode, keep_alive));
+	if (it == _errorResponses.end())
+		return SharedBuffer();
+	return (*it).second;
+}
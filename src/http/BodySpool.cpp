@@ -0,0 +1,91 @@
+#include "../../inc/http/BodySpool.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+BodySpool::BodySpool() : _block(NULL)
+{
+}
+
+BodySpool::BodySpool(const BodySpool &src) : _block(src._block)
+{
+	if (_block)
+		_block->refs++;
+}
+
+BodySpool &BodySpool::operator=(const BodySpool &src)
+{
+	if (_block == src._block)
+		return *this;
+	release();
+	_block = src._block;
+	if (_block)
+		_block->refs++;
+	return *this;
+}
+
+BodySpool::~BodySpool()
+{
+	release();
+}
+
+/**
+ * @brief Drops the reference, the last one closes the file
+ */
+void	BodySpool::release()
+{
+	if (_block && !--_block->refs)
+	{
+		close(_block->fd);
+		delete _block;
+	}
+	_block = NULL;
+}
+
+/**
+ * @brief Creates the temporary file
+ * @return false if it could not be created
+ */
+bool	BodySpool::open()
+{
+	char	path[] = BODY_SPOOL_TEMPLATE;
+	int		fd = mkstemp(path);
+
+	if (fd < 0)
+		return false;
+	unlink(path);
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	release();
+	_block = new Block;
+	_block->fd = fd;
+	_block->size = 0;
+	_block->refs = 1;
+	return true;
+}
+
+/**
+ * @brief Appends the bytes at the end of the file, a regular file never blocks
+ * @return false if the file could not be written (disk full)
+ */
+bool	BodySpool::append(const char *data, size_t size)
+{
+	if (!_block)
+		return false;
+	while (size)
+	{
+		ssize_t	bytes = write(_block->fd, data, size);
+		if (bytes < 0 && errno == EINTR)
+			continue ;
+		if (bytes <= 0)
+			return false;
+		data += bytes;
+		size -= bytes;
+		_block->size += bytes;
+	}
+	return true;
+}
+
+bool	BodySpool::isOpen() const	{ return _block != NULL; }
+int		BodySpool::fd() const		{ return _block ? _block->fd : -1; }
+size_t	BodySpool::size() const		{ return _block ? _block->size : 0; }
@@ -1,8 +1,10 @@
 #include "../../inc/http/Cgi.hpp"
 #include "../../inc/debugger/DebuggerPrinter.hpp"
-#include <sys/wait.h>
+#include "../../inc/network/ChildSupervisor.hpp"
+#include <cerrno>
+#include <sys/mman.h>
 
-CGI::CGI()
+CGI::CGI() : _fd_in(-1), _fd_out(-1), _pid(-1)
 {
 }
 
@@ -28,7 +30,7 @@ void CGI::set_environment()
 	_env["REMOTE_USER"] = "";														//If the server supports user authentication, and the script is protected, this is the username they have authenticated as.
 	_env["REMOTE_IDENT"] = "";														//If the HTTP server supports RFC 931 identification, then this variable will be set to the remote user name retrieved from the server. Usage of this variable should be limited to logging only.
 	_env["CONTENT_TYPE"] = _request.findHeader("Content-Type");						//For queries which have attached information, such as HTTP POST and PUT, this is the content type of the data.
-	_env["CONTENT_LENGTH"] = _request.findHeader("Content-Length");					//The length of the said content as given by the client.
+	_env["CONTENT_LENGTH"] = _request.isChunked() ? to_str(_request.getBodySize()) : _request.findHeader("Content-Length");	//The length of the said content as given by the client (the decoded length for a chunked body).
 	_env["HOST"] = _request.findHeader("Host");										//The length of the said content as given by the client.
 	_env["REDIRECT_STATUS"] = "500";												//If the server supports redirection, this variable should be set to the status code of the redirection.
 	_env["BODY"] = _request.getBody().first;
@@ -55,7 +57,7 @@ std::string CGI::calculate_path_info(std::string path) {
  * @param path the path
  * @param cgi_path the cgi path
  */
-CGI::CGI(Request request, std::string server_name, std::string path, std::string cgi_path) : _request(request), _server_name(server_name), _path(path), _cgi_path(cgi_path)
+CGI::CGI(Request request, std::string server_name, std::string path, std::string cgi_path) : _fd_in(-1), _fd_out(-1), _pid(-1), _request(request), _server_name(server_name), _path(path), _cgi_path(cgi_path)
 {
 	if (_request.getQuery().second)
 	{
@@ -76,6 +78,7 @@ CGI & CGI::operator=(const CGI &src)
 	_server_name = src._server_name;
 	_path = src._path;
 	_cgi_path = src._cgi_path;
+	_fastcgi_pass = src._fastcgi_pass;
 	_env = src._env;
 	_query_parameters = src._query_parameters;
 	location_dl = src.location_dl;
@@ -83,219 +86,203 @@ CGI & CGI::operator=(const CGI &src)
 }
 
 /**
- * @brief creates the tmpfiles and makes their fds nonblocking
- * TODO: We can check the fds for validity and throw an exception if they are invalid
+ * @brief prepares the stdin of the cgi, the whole body is in it before the script starts.
+ * - a spooled body is used directly, the cgi gets its own filedescriptor for it (dup) and reads it from the start
+ * - a body which fits into the buffer of a pipe is written into a pipe whose write end is closed right away
+ * - a bigger body from memory goes into an anonymous memory file (memfd), no file is created on the disk
+ * None of them can block the worker or the script, the script reads its input at its own pace.
  */
-void	CGI::set_tmps(void)
+void	CGI::set_input(void)
 {
 	USE_DEBUGGER;
-	_tmpout = tmpfile();
-	_tmpin = tmpfile();
-	_fd_in = fileno(_tmpin);
-	_fd_out = fileno(_tmpout);
-	// check return values of fcntl
-	int res1 = fcntl(_fd_in, F_SETFL, fcntl(_fd_in, F_GETFL, 0) | O_NONBLOCK);
-	if (res1 == -1)
-	{
-		debugger.verbose("FCNTL ERROR 1");
-		throw(500);
-	}
-	int res2 = fcntl(_fd_out, F_SETFL, fcntl(_fd_out, F_GETFL, 0) | O_NONBLOCK);
-	if (res2 == -1)
-	{
-		debugger.verbose("FCNTL ERROR 1");
-		throw(500);
-	}
-}
+	const std::string	&body = _request.getBody().first;
 
-/**
- * @brief writes the body from the request in _tmp_in which later will be dupped to the STDIN
- * Takes the _fd_in and writes to it the body of the request
- * We catch invalid fds and we check if
- */
-void	CGI::write_in_std_in()
-{
-	USE_DEBUGGER
-	if (!is_valid_fd(_fd_in)) return ;
-	if (!is_valid_fd(_fd_out)) return ;
-	if (_fd_in < 0 || _tmpin == NULL || _request.getBody().first.empty())
+	if (_request.getSpool().isOpen())
 	{
+		_fd_in = dup(_request.getSpool().fd());
+		if (_fd_in < 0 || lseek(_fd_in, 0, SEEK_SET) < 0)
+		{
+			debugger.verbose("Could not open the spooled body");
+			throw(500);
+		}
+		fcntl(_fd_in, F_SETFD, FD_CLOEXEC); // other cgis must not inherit it
 		return ;
 	}
-	if (write(_fd_in, _request.getBody().first.data(), _request.getBody().first.length()) < 1)
-		throw (500);
-	if (_tmpin != NULL)
-		rewind(_tmpin);
-	return ;
-}
-
-/**
- * @brief Here we wait for the child.
- * If it takes too long, it will timeout.
- */
-void CGI::wait_for_child(pid_t worker_pid)
-{
-	USE_DEBUGGER;
-	pid_t timeout_pid = fork();
-	if (timeout_pid < 0) // did not fork properly
+	if (body.size() <= CGI_INPUT_PIPE_SIZE)
 	{
-		debugger.error("[TIMEOUT] fork failed in timeout pid");
-		kill_with_error(worker_pid);
-		debugger.error("we could not fork successfully");
-		throw(503); // we throw an 503 / overloaded error
-	}
-	else if (timeout_pid == 0) // timeouted child
-	{
-		sleep(2); // this is the timeout we wait for the child to finish
-		std::exit(EXIT_SUCCESS); // ok cool, we exit successfully
-	}
-	else // parent
-	{
-		int stat_loc = 0;
-		pid_t pid = 0;
-		// child stuck we kill it to avoid zombie
-		signal(SIGCHLD, SIG_IGN);
-		// wait for the forks to be ready
-		while ((pid = waitpid(worker_pid, &stat_loc, WNOHANG)) == 0 &&
-				(pid = waitpid(timeout_pid, &stat_loc, WNOHANG)) == 0)
-			usleep(50); // check every 50 microseconds
-		if (pid == -1) // this is being called when fork failed because the process already finished.
+		int	pipefd[2];
+		if (pipe(pipefd) < 0)
 		{
-			debugger.error("[FINISHED] cgi execution");
-			kill_with_error(worker_pid);
-			kill_with_error(timeout_pid);
-			return ;
+			debugger.verbose("Could not create the cgi input pipe");
+			throw(503);
 		}
-		else if (pid == worker_pid) // this is being called if the worker finishes on time
+		fcntl(pipefd[0], F_SETFD, FD_CLOEXEC);
+		fcntl(pipefd[1], F_SETFD, FD_CLOEXEC);
+		fcntl(pipefd[1], F_SETFL, fcntl(pipefd[1], F_GETFL, 0) | O_NONBLOCK);
+		ssize_t	written = body.empty() ? 0 : write(pipefd[1], body.data(), body.size());
+		close(pipefd[1]);
+		if (written == (ssize_t) body.size())
 		{
-			kill_with_error(timeout_pid); // let's kill the timeout child, it's not needed anymore
-			if (!WIFSIGNALED(stat_loc) && WEXITSTATUS(stat_loc) == 0) // if the worker exited normally
-			{
-				debugger.error("[FINISHED] sometimes happens cgi execution");
-				return ; // we're done
-			}
-			debugger.error("Worker did not exit normally."); // this is being called if the worker timed out
-			//throw(502); // else we throw a 500 error
+			_fd_in = pipefd[0];
 			return ;
 		}
-		else
+		close(pipefd[0]); // the pipe is smaller than usual (pipe-user-pages-soft), the body goes into a memfd
+	}
+#ifdef MFD_CLOEXEC
+	_fd_in = memfd_create("cgi-input", MFD_CLOEXEC);
+#else
+	FILE	*file = tmpfile(); // no memfd on this system
+	_fd_in = file ? dup(fileno(file)) : -1;
+	if (file)
+		fclose(file);
+	if (_fd_in >= 0)
+		fcntl(_fd_in, F_SETFD, FD_CLOEXEC);
+#endif
+	if (_fd_in < 0)
+	{
+		debugger.verbose("Could not create the cgi input");
+		throw(500);
+	}
+	for (size_t written = 0; written < body.size(); )
+	{
+		ssize_t	bytes = write(_fd_in, body.data() + written, body.size() - written);
+		if (bytes < 0 && errno == EINTR)
+			continue ;
+		if (bytes <= 0)
 		{
-			debugger.error("[TIMEOUT] cgi gateway error in wait_for_child"); // this is being called if the worker timed out
-			kill_with_error(worker_pid); // let's kill the worker
-			throw(504); // that is a gateway timeout
+			debugger.verbose("Could not write the body into the cgi input");
+			throw(500);
 		}
+		written += bytes;
 	}
+	if (lseek(_fd_in, 0, SEEK_SET) < 0)
+		throw(500);
 }
 
 /**
- * @brief executes the cgi an writes the return of it into _tmp_out
+ * @brief starts the cgi, its output is written into a pipe which is read with read_output while it runs.
+ * argv and the environment are assembled in one SpawnBlock before the script is started, by a helper
+ * of the CgiHelperPool or with posix_spawn from the worker.
+ * We do not wait for the script, the event loop goes on serving the other clients.
  */
 void	CGI::execute_cgi(void)
 {
 	USE_DEBUGGER;
+	int			pipefd[2];
+	SpawnBlock	job;
+
 	set_environment();
-	pid_t pid = fork();
-	if (pid < 0)
+	if (!is_valid_fd(_fd_in))
+	{
+		debugger.error("The input of the CGI is not valid.");
+		throw(502);
+	}
+	job.addArgument(_cgi_path);
+	job.addArgument(split_once_on_delimiter(_path, '?')[0]);
+	for (std::vector<std::string>::iterator it = _query_parameters.begin(); it != _query_parameters.end(); ++it)
+		job.addArgument(*it);
+	for (std::map<std::string, std::string>::iterator it = _env.begin(); it != _env.end(); ++it)
+		job.addEnvironment(it->first, it->second);
+	if (pipe(pipefd) < 0)
 	{
-		debugger.error("Could not fork CGI.");
+		debugger.error("Could not create the CGI output pipe.");
 		throw(503);
 	}
-	else if (pid == 0) // child
+	fcntl(pipefd[0], F_SETFD, FD_CLOEXEC); // dup2 clears the flag on the stdout of the child
+	fcntl(pipefd[1], F_SETFD, FD_CLOEXEC);
+	if (!CgiHelperPool::getInstance().has(_cgi_path) || !CgiHelperPool::getInstance().launch(_cgi_path, job, _fd_in, pipefd[1], _ticket))
 	{
-		// we check if the file descriptors are valid, if not, we close them to not leak them.
-		if (!is_valid_fd(_fd_in) || !is_valid_fd(_fd_out))
-		{
-			debugger.error("Closing connection 4");
-			close(_fd_out);
-			std::exit(EXIT_FAILURE);
-		}
-		if (dup2(fileno(_tmpin), STDIN_FILENO) < 0 ||
-			dup2(fileno(_tmpout), STDOUT_FILENO) < 0)
-		{
-			debugger.error("Failed to dup2 the CGI.");
-			std::exit(1); // exit the child
-		}
-		_envp = map_to_array(_env);
-		_query_parameters.insert(_query_parameters.begin(), split_once_on_delimiter(_path, '?')[0].c_str());
-		_query_parameters.insert(_query_parameters.begin(), _cgi_path.c_str());
-		_argvp = vec_to_array(_query_parameters);
-		execve(_cgi_path.c_str(), _argvp, _envp);
-		int i = 0;
-		while (_argvp[i])
-		{
-			free(_argvp[i]);
-			i++;
-		}
-		i = 0;
-		//delete _argvp;
-		while (_envp[i])
+		_pid = job.spawn(_fd_in, pipefd[1]);
+		if (_pid < 0)
 		{
-			free(_envp[i]);
-			i++;
+			int	error = errno;
+			debugger.error("Could not execute CGI " + _cgi_path + ": " + strerror(error));
+			close(pipefd[0]);
+			close(pipefd[1]);
+			throw((error == EAGAIN || error == ENOMEM) ? 503 : 502);
 		}
-		// delete _envp;
-		delete _argvp; // --> TEST GROWING MEMORY FIX
-		delete _envp; // --> TEST GROWING MEMORY FIX
-		debugger.error("Could not execute CGI. Error happened in execute_cgi");
-		close(_fd_in);
-		close(_fd_out);
-		std::exit(1); // exit the child
-	}
-	else // parent
-	{
-		return wait_for_child(pid);
+		ChildSupervisor::getInstance().watch(_pid);
 	}
+	close(pipefd[1]);
+	close(_fd_in); // the script has its own copy
+	_fd_in = -1;
+	fcntl(pipefd[0], F_SETFL, fcntl(pipefd[0], F_GETFL, 0) | O_NONBLOCK);
+	_fd_out = pipefd[0];
 }
 
 /**
- * @brief writes the return of the cgi into the body of the responseo
+ * @brief reads the next part of the output of the cgi and appends it to output
+ * @return the result of read(), 0 once the script closed its output
  */
-void	CGI::read_in_buff(void)
+ssize_t	CGI::read_output(std::string &output)
 {
-	USE_DEBUGGER;
-	if (_fd_in < 0)
-		return;
-	if (_tmpout == NULL)
-		return;
-	if (_tmpin == NULL)
-		return;
-	try {
-		if (!is_valid_fd(_fd_in) || !is_valid_fd(_fd_out))
-		{
-			close(_fd_in);
-			throw(503);
-			return ;
-		}
-		if (fseek(_tmpout, 0, SEEK_END) < 0)							//set the courser in the filestream to the end
-			throw (500);
-		if ((_tmp_size = ftell(_tmpout)) == -1)								//assign the position of the courser to _tmp_size
-			throw (500);
-	} catch (int error) {
-		throw (501);
-		return ;
-	}
-	rewind(_tmpout);	// move the courser back to the beginning
-	_buf.resize(_tmp_size);		//inrease the underlying char array in _buf by the value of _tmp_size
-	if (read(_fd_out, (char*)(_buf.data()), _tmp_size) < 1)
-	{
+	char	buffer[CGI_READ_SIZE];
+
+	if (isFastCgi())
+		return _fastcgi.read_output(output);
+	ssize_t bytes = read(_fd_out, buffer, sizeof(buffer));
+	if (bytes > 0)
+		output.append(buffer, bytes);
+	return bytes;
+}
+
+/**
+ * @brief closes the pipe and the input of the cgi and hands the script over to the ChildSupervisor.
+ * A script which is still running gets killed if kill_script is set (timeout, client gone),
+ * otherwise it has CHILD_EXIT_GRACE seconds left to exit. Nothing here waits for the script.
+ */
+void	CGI::finish(bool kill_script)
+{
+	if (isFastCgi())
+		_fastcgi.finish(kill_script);
+	else if (_fd_out >= 0)
 		close(_fd_out);
+	if (_fd_in >= 0)
 		close(_fd_in);
-		fclose(_tmpout);
-		fclose(_tmpin);
-		throw (500);
+	_fd_out = -1;
+	_fd_in = -1;
+	if (_ticket.fd >= 0 && kill_script)
+		CgiHelperPool::getInstance().terminate(_ticket);
+	else if (_ticket.fd >= 0)
+		CgiHelperPool::getInstance().release(_ticket);
+	else if (kill_script)
+		ChildSupervisor::getInstance().terminate(_pid);
+	else
+		ChildSupervisor::getInstance().release(_pid);
+	_ticket = CgiTicket();
+	_pid = -1;
+}
+
+void	CGI::set_fastcgi_pass(const std::string &address)	{ _fastcgi_pass = address; }
+bool	CGI::isFastCgi(void) const	{ return !_fastcgi_pass.empty(); }
+
+/**
+ * @brief sends the request to the FastCGI responder instead of starting a script.
+ * The environment of a cgi are the params, SCRIPT_FILENAME tells the responder which script to run.
+ * The body is sent from memory or from the spool, no input file is needed.
+ */
+void	CGI::start_fastcgi(void)
+{
+	USE_DEBUGGER;
+	set_environment();
+	std::map<std::string, std::string>	params(_env);
+	params.erase("BODY"); // sent as stdin
+	params["SCRIPT_FILENAME"] = get_abs_path(split_once_on_delimiter(_path, '?')[0]);
+	if (!_fastcgi.begin(_fastcgi_pass, params, _request.getBody().first, _request.getSpool()))
+	{
+		debugger.error("Could not connect to the FastCGI server " + _fastcgi_pass);
+		throw(502);
 	}
-	debugger.verbose("Closing connection 5");
-	close(_fd_out);
-	close(_fd_in);
-	fclose(_tmpout);
-	fclose(_tmpin);
-	return ;
+	_fd_out = _fastcgi.fd();
 }
 
-std::string	CGI::get_buf(void)
+/**
+ * @brief writes the request to the FastCGI responder
+ * @return 1 once it is sent, 0 if the connection would block, -1 if the responder is not reachable
+ */
+int		CGI::send_fastcgi(void)
 {
-	std::string	ret(_buf);
-	return ret;
+	return _fastcgi.send();
 }
 
 std::string	CGI::get_query(std::string referer)
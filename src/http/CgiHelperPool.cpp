@@ -0,0 +1,404 @@
+#include "../../inc/http/CgiHelperPool.hpp"
+#include "../../inc/network/ChildSupervisor.hpp"
+#include "../../inc/network/ControlSignals.hpp"
+#include "../../inc/debugger/DebuggerPrinter.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#define HELPER_SPAWN 1 // worker to zygote, carries the socket of the new helper
+#define HELPER_JOB 2 // worker to helper, arena of a SpawnBlock, carries stdin and stdout of the script
+#define HELPER_KILL 3 // worker to helper, the client gave up on the script
+#define HELPER_RELEASE 4 // worker to helper, the script closed its output
+#define HELPER_ACK 5 // helper to worker, the script of the job was started
+
+struct HelperMessage
+{
+	unsigned int	type;
+	unsigned int	id;
+	unsigned int	length; // bytes of the payload behind the message
+};
+
+/**
+ * @brief Sends a message and its payload, fds are passed along with the first byte (SCM_RIGHTS)
+ */
+static bool	send_message(int fd, unsigned int type, unsigned int id, const std::string &payload, const int *fds, int count)
+{
+	HelperMessage	message = {type, id, (unsigned int) payload.size()};
+	std::string		data((const char *) &message, sizeof(message));
+	char			control[CMSG_SPACE(2 * sizeof(int))];
+	struct iovec	iov;
+	struct msghdr	msg;
+	size_t			sent = 0;
+
+	data += payload;
+	std::memset(&msg, 0, sizeof(msg));
+	std::memset(control, 0, sizeof(control));
+	iov.iov_base = (void *) data.data();
+	iov.iov_len = data.size();
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	if (count)
+	{
+		msg.msg_control = control;
+		msg.msg_controllen = CMSG_SPACE(count * sizeof(int));
+		struct cmsghdr	*cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+		std::memcpy(CMSG_DATA(cmsg), fds, count * sizeof(int));
+	}
+	while (sent < data.size())
+	{
+		ssize_t	bytes = sent ? write(fd, data.data() + sent, data.size() - sent) : sendmsg(fd, &msg, 0);
+		if (bytes < 0 && errno == EINTR)
+			continue ;
+		if (bytes <= 0)
+			return false;
+		sent += bytes;
+	}
+	return true;
+}
+
+/**
+ * @brief Receives a message, its payload and the fds passed along with it (close-on-exec)
+ * @return false once the other side closed the socket
+ */
+static bool	receive_message(int fd, HelperMessage &message, std::string &payload, std::vector<int> &fds)
+{
+	char			control[CMSG_SPACE(2 * sizeof(int))];
+	struct iovec	iov;
+	struct msghdr	msg;
+	size_t			received = 0;
+
+	fds.clear();
+	while (received < sizeof(message))
+	{
+		std::memset(&msg, 0, sizeof(msg));
+		iov.iov_base = (char *) &message + received;
+		iov.iov_len = sizeof(message) - received;
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		ssize_t	bytes = recvmsg(fd, &msg, 0);
+		if (bytes < 0 && errno == EINTR)
+			continue ;
+		if (bytes <= 0)
+			return false;
+		for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+				continue ;
+			for (size_t i = 0; (i + 1) * sizeof(int) <= cmsg->cmsg_len - CMSG_LEN(0); i++)
+			{
+				int	passed;
+				std::memcpy(&passed, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+				fcntl(passed, F_SETFD, FD_CLOEXEC);
+				fds.push_back(passed);
+			}
+		}
+		received += bytes;
+	}
+	payload.resize(message.length);
+	for (received = 0; received < message.length; )
+	{
+		ssize_t	bytes = read(fd, &payload[received], message.length - received);
+		if (bytes < 0 && errno == EINTR)
+			continue ;
+		if (bytes <= 0)
+			return false;
+		received += bytes;
+	}
+	return true;
+}
+
+/**
+ * @brief Main loop of a helper: starts the scripts of the jobs and reaps them.
+ * Once the worker closed the socket (helper replaced, worker gone) the helper exits after its last script.
+ */
+static void	run_helper(int fd)
+{
+	ChildSupervisor				&supervisor = ChildSupervisor::getInstance();
+	std::map<unsigned int, pid_t>	jobs;
+	HelperMessage				message;
+	std::string					payload;
+	std::vector<int>			fds;
+
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	supervisor.install();
+	while (fd >= 0 || supervisor.hasChildren())
+	{
+		struct pollfd	pfd[2] = {{supervisor.getFd(), POLLIN, 0}, {fd, POLLIN, 0}};
+		poll(pfd, fd >= 0 ? 2 : 1, 1000);
+		if (pfd[0].revents & POLLIN)
+			supervisor.reap();
+		if (fd >= 0 && pfd[1].revents)
+		{
+			if (!receive_message(fd, message, payload, fds))
+			{
+				for (std::map<unsigned int, pid_t>::iterator it = jobs.begin(); it != jobs.end(); ++it)
+					supervisor.release(it->second);
+				jobs.clear();
+				close(fd);
+				fd = -1;
+				continue ;
+			}
+			if (message.type == HELPER_JOB)
+			{
+				SpawnBlock	job;
+				pid_t		pid = -1;
+				if (fds.size() == 2 && job.assign(payload))
+					pid = job.spawn(fds[0], fds[1]);
+				supervisor.watch(pid);
+				if (pid > 0)
+					jobs[message.id] = pid;
+				send_message(fd, HELPER_ACK, message.id, "", NULL, 0);
+			}
+			else if (message.type == HELPER_KILL && jobs.count(message.id))
+				supervisor.terminate(jobs[message.id]);
+			else if (message.type == HELPER_RELEASE && jobs.count(message.id))
+				supervisor.release(jobs[message.id]);
+			if (message.type == HELPER_KILL || message.type == HELPER_RELEASE)
+				jobs.erase(message.id);
+			for (size_t i = 0; i < fds.size(); i++)
+				close(fds[i]);
+		}
+		supervisor.expire(std::time(NULL));
+	}
+	_exit(0);
+}
+
+/**
+ * @brief Main loop of the zygote: forks a helper for every socket the worker sends.
+ * It exits together with the worker (socket closed), the helpers exit after their scripts.
+ * The control signals of the worker (or the master it was forked from) are reset, the helpers inherit the defaults.
+ */
+static void	run_zygote(int fd)
+{
+	HelperMessage		message;
+	std::string			payload;
+	std::vector<int>	fds;
+
+	ControlSignals::getInstance().uninstall();
+	signal(SIGCHLD, SIG_IGN); // the helpers are reaped by the kernel
+	while (receive_message(fd, message, payload, fds))
+	{
+		if (message.type == HELPER_SPAWN && fds.size() == 1 && fork() == 0)
+		{
+			close(fd);
+			signal(SIGCHLD, SIG_DFL);
+			run_helper(fds[0]);
+		}
+		for (size_t i = 0; i < fds.size(); i++)
+			close(fds[i]);
+	}
+	_exit(0);
+}
+
+CgiHelperPool::CgiHelperPool() : _zygote(-1), _next_id(0)
+{
+}
+
+CgiHelperPool::~CgiHelperPool()
+{
+}
+
+/**
+ * @brief Starts the zygote and the first helpers of every cgi_path with cgi_helpers.
+ * Has to be called before the worker has any connection or event loop, the zygote keeps what is open now.
+ * @param inherited filedescriptors the zygote closes (listening sockets)
+ */
+void	CgiHelperPool::start(const std::vector<ServerBlock> &serverBlocks, const std::vector<int> &inherited)
+{
+	USE_DEBUGGER;
+	for (size_t i = 0; i < serverBlocks.size(); i++)
+	{
+		std::vector<ConfigurationKey>	locations = serverBlocks[i].getConfigurationKeysWithType(LOCATION);
+		for (size_t j = 0; j < locations.size(); j++)
+		{
+			ConfigurationKey	&location = locations[j];
+			if (!location.cgi_helpers_max || location.cgi_path.empty() || _pools.count(location.cgi_path))
+				continue ;
+			Pool	&pool = _pools[location.cgi_path];
+			pool.min = location.cgi_helpers_min;
+			pool.max = location.cgi_helpers_max;
+			pool.requests = location.cgi_helper_requests;
+		}
+	}
+	if (_pools.empty())
+		return ;
+	int	sv[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+	{
+		_pools.clear();
+		return ;
+	}
+	pid_t	pid = fork();
+	if (pid == 0)
+	{
+		close(sv[0]);
+		for (size_t i = 0; i < inherited.size(); i++)
+			close(inherited[i]);
+		run_zygote(sv[1]);
+	}
+	close(sv[1]);
+	if (pid < 0)
+	{
+		debugger.error("Could not fork the cgi helper zygote, scripts are started by the worker.");
+		close(sv[0]);
+		_pools.clear();
+		return ;
+	}
+	_zygote = sv[0];
+	fcntl(_zygote, F_SETFD, FD_CLOEXEC);
+	for (std::map<std::string, Pool>::iterator it = _pools.begin(); it != _pools.end(); ++it)
+		while (it->second.helpers.size() < it->second.min && spawnHelper(it->second))
+			;
+}
+
+/**
+ * @brief Returns true if the scripts of cgi_path are started by helpers
+ */
+bool	CgiHelperPool::has(const std::string &cgi_path) const
+{
+	return _zygote >= 0 && _pools.count(cgi_path);
+}
+
+/**
+ * @brief Asks the zygote for a new helper
+ */
+bool	CgiHelperPool::spawnHelper(Pool &pool)
+{
+	int				sv[2];
+	struct timeval	timeout = {CGI_HELPER_SEND_TIMEOUT, 0};
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+		return false;
+	bool	sent = send_message(_zygote, HELPER_SPAWN, 0, "", &sv[1], 1);
+	close(sv[1]);
+	if (!sent)
+	{
+		close(sv[0]);
+		return false;
+	}
+	fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+	setsockopt(sv[0], SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	Helper	helper = {sv[0], 0, 0, 0, false};
+	pool.helpers.push_back(helper);
+	return true;
+}
+
+/**
+ * @brief Reads the acknowledgements of the forked jobs, a helper which closed its socket is dropped
+ */
+void	CgiHelperPool::drainAcknowledgements(Pool &pool)
+{
+	HelperMessage	message;
+
+	for (size_t i = pool.helpers.size(); i-- > 0; )
+	{
+		ssize_t	bytes;
+		while ((bytes = recv(pool.helpers[i].fd, &message, sizeof(message), MSG_DONTWAIT)) == sizeof(message))
+			if (message.type == HELPER_ACK && pool.helpers[i].pending)
+				pool.helpers[i].pending--;
+		if (bytes == 0 || (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+			closeHelper(pool, i);
+	}
+}
+
+/**
+ * @brief Sends the script to a helper which is not busy forking, a new one is started if there is none
+ * @param job argv and environment of the script, argv[0] is executed
+ * @param in stdin of the script
+ * @param out stdout of the script (write end of the output pipe)
+ * @return false if no helper took the job, the worker has to start the script itself
+ */
+bool	CgiHelperPool::launch(const std::string &cgi_path, const SpawnBlock &job, int in, int out, CgiTicket &ticket)
+{
+	std::map<std::string, Pool>::iterator	found = _pools.find(cgi_path);
+	if (_zygote < 0 || found == _pools.end() || job.empty())
+		return false;
+	Pool	&pool = found->second;
+	drainAcknowledgements(pool);
+
+	size_t	choice = pool.helpers.size();
+	size_t	active = 0;
+	for (size_t i = 0; i < pool.helpers.size(); i++)
+	{
+		if (pool.helpers[i].retiring)
+			continue ;
+		active++;
+		if (choice == pool.helpers.size() || pool.helpers[i].pending < pool.helpers[choice].pending)
+			choice = i;
+	}
+	if ((choice == pool.helpers.size() || pool.helpers[choice].pending) && active < pool.max && spawnHelper(pool))
+		choice = pool.helpers.size() - 1;
+	if (choice == pool.helpers.size())
+		return false;
+
+	int		fds[2] = {in, out};
+	Helper	&helper = pool.helpers[choice];
+	if (!send_message(helper.fd, HELPER_JOB, ++_next_id, job.data(), fds, 2))
+	{
+		closeHelper(pool, choice);
+		return false;
+	}
+	helper.pending++;
+	helper.live++;
+	if (++helper.served >= pool.requests)
+		helper.retiring = true;
+	ticket.fd = helper.fd;
+	ticket.id = _next_id;
+	return true;
+}
+
+/**
+ * @brief Kills the script of the ticket and everything it started
+ */
+void	CgiHelperPool::terminate(const CgiTicket &ticket)
+{
+	endTicket(ticket, HELPER_KILL);
+}
+
+/**
+ * @brief The script closed its output, it has CHILD_EXIT_GRACE seconds left to exit
+ */
+void	CgiHelperPool::release(const CgiTicket &ticket)
+{
+	endTicket(ticket, HELPER_RELEASE);
+}
+
+void	CgiHelperPool::endTicket(const CgiTicket &ticket, unsigned int type)
+{
+	for (std::map<std::string, Pool>::iterator it = _pools.begin(); it != _pools.end(); ++it)
+	{
+		for (size_t i = 0; i < it->second.helpers.size(); i++)
+		{
+			Helper	&helper = it->second.helpers[i];
+			if (helper.fd != ticket.fd)
+				continue ;
+			send_message(helper.fd, type, ticket.id, "", NULL, 0);
+			if (helper.live)
+				helper.live--;
+			if (helper.retiring && !helper.live)
+				closeHelper(it->second, i);
+			return ;
+		}
+	}
+}
+
+/**
+ * @brief Closes the socket of the helper, it exits after its last script
+ */
+void	CgiHelperPool::closeHelper(Pool &pool, size_t index)
+{
+	close(pool.helpers[index].fd);
+	pool.helpers.erase(pool.helpers.begin() + index);
+}
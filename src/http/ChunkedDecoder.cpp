@@ -0,0 +1,163 @@
+#include "../../inc/http/ChunkedDecoder.hpp"
+#include <algorithm>
+#include <cctype>
+
+ChunkedDecoder::ChunkedDecoder()
+{
+	reset();
+}
+
+ChunkedDecoder::ChunkedDecoder(const ChunkedDecoder &src)
+{
+	*this = src;
+}
+
+ChunkedDecoder &ChunkedDecoder::operator=(const ChunkedDecoder &rhs)
+{
+	_state = rhs._state;
+	_remaining = rhs._remaining;
+	_digits = rhs._digits;
+	_line = rhs._line;
+	_trailer = rhs._trailer;
+	_error = rhs._error;
+	return *this;
+}
+
+ChunkedDecoder::~ChunkedDecoder()
+{
+}
+
+/**
+ * @brief Prepares the decoder for the next body
+ */
+void	ChunkedDecoder::reset()
+{
+	_state = C_SIZE;
+	_remaining = 0;
+	_digits = 0;
+	_line = 0;
+	_trailer = 0;
+	_error = 0;
+}
+
+int		ChunkedDecoder::getError() const	{ return _error; }
+
+/**
+ * @brief Decodes the bytes at the beginning of data.
+ * @param consumed set to the framing bytes in front of the body bytes (all bytes looked at if there is no body byte)
+ * @param length set to the body bytes at data + consumed, the caller has to take all of them
+ * @return CHUNK_DATA if length body bytes are available, CHUNK_DONE once the body is complete,
+ * CHUNK_NEED_MORE or CHUNK_ERROR with the status code in getError() (400, 413, 431)
+ */
+ChunkStatus	ChunkedDecoder::decode(const char *data, size_t size, size_t &consumed, size_t &length)
+{
+	consumed = 0;
+	length = 0;
+	if (_error)
+		return CHUNK_ERROR;
+	while (consumed < size)
+	{
+		if (_state == C_DATA)
+		{
+			length = std::min(_remaining, size - consumed);
+			_remaining -= length;
+			if (!_remaining)
+				_state = C_DATA_CR;
+			return CHUNK_DATA;
+		}
+		if (_state == C_DONE)
+			return CHUNK_DONE;
+
+		char	c = data[consumed++];
+
+		if (_state == C_SIZE || _state == C_EXTENSION)
+		{
+			if (++_line > CHUNK_LINE_MAXIMUM_SIZE)
+				return fail(400);
+		}
+		if (_state == C_SIZE)
+		{
+			if (std::isxdigit((unsigned char)c))
+			{
+				if (++_digits > CHUNK_SIZE_MAXIMUM_DIGITS)
+					return fail(413);
+				_remaining = _remaining * 16 + (std::isdigit((unsigned char)c) ? c - '0' : std::tolower((unsigned char)c) - 'a' + 10);
+			}
+			else if (!_digits)
+				return fail(400);
+			else if (c == ';' || c == ' ' || c == '\t')
+				_state = C_EXTENSION;
+			else if (c == '\r')
+				_state = C_SIZE_LF;
+			else if (c == '\n')
+				endSizeLine();
+			else
+				return fail(400);
+		}
+		else if (_state == C_EXTENSION)
+		{
+			if (c == '\r')
+				_state = C_SIZE_LF;
+			else if (c == '\n')
+				endSizeLine();
+			else if ((unsigned char)c < ' ' && c != '\t')
+				return fail(400);
+		}
+		else if (_state == C_SIZE_LF)
+		{
+			if (c != '\n')
+				return fail(400);
+			endSizeLine();
+		}
+		else if (_state == C_DATA_CR || _state == C_DATA_LF)
+		{
+			if (c == '\r' && _state == C_DATA_CR)
+				_state = C_DATA_LF;
+			else if (c == '\n')
+				_state = C_SIZE;
+			else
+				return fail(400);
+		}
+		else if (_state == C_TRAILER_START || _state == C_TRAILER)
+		{
+			if (++_trailer > CHUNK_TRAILER_MAXIMUM_SIZE)
+				return fail(431);
+			if (c == '\n' && _state == C_TRAILER_START)
+				_state = C_DONE;
+			else if (c == '\r' && _state == C_TRAILER_START)
+				_state = C_END_LF;
+			else if (c == '\n')
+				_state = C_TRAILER_START;
+			else
+				_state = C_TRAILER;
+		}
+		else if (_state == C_END_LF)
+		{
+			if (c != '\n')
+				return fail(400);
+			_state = C_DONE;
+		}
+	}
+	if (_state == C_DONE)
+		return CHUNK_DONE;
+	return CHUNK_NEED_MORE;
+}
+
+/**
+ * @brief The chunk size line is complete, the last chunk (size 0) is followed by the trailer fields
+ */
+void	ChunkedDecoder::endSizeLine()
+{
+	_state = _remaining ? C_DATA : C_TRAILER_START;
+	_digits = 0;
+	_line = 0;
+}
+
+/**
+ * @brief Remembers the error, the decoder stays in this state until reset()
+ */
+ChunkStatus	ChunkedDecoder::fail(int status)
+{
+	_error = status;
+	return CHUNK_ERROR;
+}
@@ -0,0 +1,371 @@
+#include "../../inc/http/FastCgi.hpp"
+#include "../../inc/debugger/DebuggerPrinter.hpp"
+#include "../../inc/utility/utility.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define FCGI_VERSION_1 1
+#define FCGI_HEADER_SIZE 8
+#define FCGI_BEGIN_REQUEST 1
+#define FCGI_END_REQUEST 3
+#define FCGI_PARAMS 4
+#define FCGI_STDIN 5
+#define FCGI_STDOUT 6
+#define FCGI_STDERR 7
+#define FCGI_RESPONDER 1
+#define FCGI_KEEP_CONN 1
+#define FCGI_REQUEST_ID 1 // one request at a time per connection
+
+FastCgiPool::FastCgiPool()
+{
+}
+
+FastCgiPool::~FastCgiPool()
+{
+	for (std::map<std::string, std::vector<int> >::iterator it = _idle.begin(); it != _idle.end(); ++it)
+		for (size_t i = 0; i < it->second.size(); i++)
+			close(it->second[i]);
+}
+
+/**
+ * @brief Returns a connection to the upstream, an idle one if there is one which is still open
+ * @param address unix:/path/to/socket or ip:port
+ * @return the non blocking socket (the connect might still be in progress) or -1
+ */
+int	FastCgiPool::acquire(const std::string &address)
+{
+	std::vector<int>	&idle = _idle[address];
+
+	while (!idle.empty())
+	{
+		int		fd = idle.back();
+		char	byte;
+
+		idle.pop_back();
+		if (recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return fd;
+		close(fd); // the upstream closed it while it was idle
+	}
+	return connectTo(address);
+}
+
+/**
+ * @brief Keeps the connection for the next request, closes it if there are enough idle ones
+ */
+void	FastCgiPool::release(const std::string &address, int fd)
+{
+	std::vector<int>	&idle = _idle[address];
+
+	if (idle.size() >= FASTCGI_POOL_MAXIMUM_IDLE)
+		close(fd);
+	else
+		idle.push_back(fd);
+}
+
+/**
+ * @brief Splits ip:port, localhost is accepted as ip
+ */
+static bool	split_inet_address(const std::string &address, struct sockaddr_in &so)
+{
+	size_t		colon = address.rfind(':');
+	if (colon == std::string::npos || colon + 1 == address.length() || address.length() - colon > 6)
+		return false;
+	std::string	host = address.substr(0, colon);
+	std::string	port = address.substr(colon + 1);
+	if (port.find_first_not_of("0123456789") != std::string::npos || std::atoi(port.c_str()) < 1 || std::atoi(port.c_str()) > 65535)
+		return false;
+	if (host == "localhost")
+		host = "127.0.0.1";
+	std::memset(&so, 0, sizeof(so));
+	so.sin_family = AF_INET;
+	so.sin_port = htons(std::atoi(port.c_str()));
+	return inet_pton(AF_INET, host.c_str(), &so.sin_addr) == 1;
+}
+
+/**
+ * @brief Checks the value of fastcgi_pass: unix:/path/to/socket or ip:port
+ */
+bool	FastCgiPool::isValidAddress(const std::string &address)
+{
+	struct sockaddr_in	so;
+
+	if (address.compare(0, 5, "unix:") == 0)
+		return address.length() > 5 && address.length() - 5 < sizeof(((struct sockaddr_un *) 0)->sun_path);
+	return split_inet_address(address, so);
+}
+
+/**
+ * @brief Opens a new non blocking connection, a connect in progress is finished in the event loop
+ * @return the socket or -1
+ */
+int	FastCgiPool::connectTo(const std::string &address)
+{
+	struct sockaddr_un	un;
+	struct sockaddr_in	in;
+	struct sockaddr		*so = (struct sockaddr *) &in;
+	socklen_t			size = sizeof(in);
+
+	if (address.compare(0, 5, "unix:") == 0)
+	{
+		std::memset(&un, 0, sizeof(un));
+		un.sun_family = AF_UNIX;
+		std::strncpy(un.sun_path, address.c_str() + 5, sizeof(un.sun_path) - 1);
+		so = (struct sockaddr *) &un;
+		size = sizeof(un);
+	}
+	else if (!split_inet_address(address, in))
+		return -1;
+	int	fd = socket(so->sa_family, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	if (connect(fd, so, size) < 0 && errno != EINPROGRESS)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * The connection is not copied, a copy starts without one (like the filedescriptors of the CGI).
+ * The owner has to call finish(), the destructor does not close the connection.
+ */
+FastCgiConnection::FastCgiConnection() : _fd(-1), _out_offset(0), _body_size(0), _body_sent(0), _stdin_closed(false), _ended(false)
+{
+}
+
+FastCgiConnection::FastCgiConnection(const FastCgiConnection &src) : _fd(-1), _out_offset(0), _body_size(0), _body_sent(0), _stdin_closed(false), _ended(false)
+{
+	(void) src;
+}
+
+FastCgiConnection &FastCgiConnection::operator=(const FastCgiConnection &rhs)
+{
+	(void) rhs;
+	return *this;
+}
+
+FastCgiConnection::~FastCgiConnection()
+{
+}
+
+int		FastCgiConnection::fd() const	{ return _fd; }
+
+/**
+ * @brief Gets a connection and encodes the begin of the request and the params
+ * @param params the cgi environment
+ * @param body the request body if it was not spooled
+ * @return false if the upstream can not be reached
+ */
+bool	FastCgiConnection::begin(const std::string &address, const std::map<std::string, std::string> &params,
+			const std::string &body, const BodySpool &spool)
+{
+	char	begin[8] = {0, FCGI_RESPONDER, FCGI_KEEP_CONN, 0, 0, 0, 0, 0};
+
+	finish(true);
+	_fd = FastCgiPool::getInstance().acquire(address);
+	if (_fd < 0)
+		return false;
+	_address = address;
+	_out.clear();
+	_out_offset = 0;
+	_in.clear();
+	_body = spool.isOpen() ? std::string() : body;
+	_spool = spool;
+	_body_size = spool.isOpen() ? spool.size() : body.size();
+	_body_sent = 0;
+	_stdin_closed = false;
+	_ended = false;
+	appendRecord(FCGI_BEGIN_REQUEST, begin, sizeof(begin));
+	std::string	encoded;
+	for (std::map<std::string, std::string>::const_iterator it = params.begin(); it != params.end(); ++it)
+		appendParam(it->first, it->second, encoded);
+	for (size_t offset = 0; offset < encoded.size(); offset += FASTCGI_RECORD_SIZE)
+		appendRecord(FCGI_PARAMS, encoded.data() + offset, std::min((size_t) FASTCGI_RECORD_SIZE, encoded.size() - offset));
+	appendRecord(FCGI_PARAMS, NULL, 0);
+	return true;
+}
+
+/**
+ * @brief Writes the encoded records, the body is encoded record by record while the previous one is out
+ * @return 1 once the whole request is sent, 0 if the connection would block, -1 on an error
+ */
+int		FastCgiConnection::send()
+{
+	while (1)
+	{
+		while (_out_offset < _out.size())
+		{
+			ssize_t	bytes = write(_fd, _out.data() + _out_offset, _out.size() - _out_offset);
+			if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) // also while the connect is in progress
+				return 0;
+			if (bytes <= 0)
+				return -1;
+			_out_offset += bytes;
+		}
+		_out.clear();
+		_out_offset = 0;
+		if (_stdin_closed)
+			return 1;
+		if (!fillStdin())
+			return -1;
+	}
+}
+
+/**
+ * @brief Encodes the next part of the body as stdin record, or the empty record which ends stdin
+ */
+bool	FastCgiConnection::fillStdin()
+{
+	size_t	length = std::min((size_t) FASTCGI_RECORD_SIZE, _body_size - _body_sent);
+
+	if (!length)
+	{
+		appendRecord(FCGI_STDIN, NULL, 0);
+		_stdin_closed = true;
+		return true;
+	}
+	if (!_spool.isOpen())
+	{
+		appendRecord(FCGI_STDIN, _body.data() + _body_sent, length);
+		_body_sent += length;
+		return true;
+	}
+	std::vector<char>	buffer(length);
+	size_t				filled = 0;
+	while (filled < length)
+	{
+		ssize_t	bytes = pread(_spool.fd(), &buffer[filled], length - filled, _body_sent + filled);
+		if (bytes <= 0)
+			return false;
+		filled += bytes;
+	}
+	appendRecord(FCGI_STDIN, &buffer[0], length);
+	_body_sent += length;
+	return true;
+}
+
+/**
+ * @brief Reads the answer of the upstream and appends the stdout stream to output
+ * @return the stdout bytes appended, 0 once the request ended, -1 with errno set (EAGAIN if nothing is waiting)
+ */
+ssize_t	FastCgiConnection::read_output(std::string &output)
+{
+	char	buffer[FASTCGI_READ_SIZE];
+	size_t	before = output.size();
+
+	while (!_ended)
+	{
+		ssize_t	bytes = read(_fd, buffer, sizeof(buffer));
+		if (bytes == 0)
+			errno = ECONNRESET; // closed in the middle of the request
+		if (bytes <= 0)
+			return -1;
+		_in.append(buffer, bytes);
+		if (!decodeRecords(output))
+		{
+			errno = EPROTO;
+			return -1;
+		}
+		if (output.size() > before)
+			break ;
+	}
+	return output.size() - before;
+}
+
+/**
+ * @brief Decodes the complete records in _in, unknown record types are skipped
+ * @return false if the upstream does not speak FastCGI
+ */
+bool	FastCgiConnection::decodeRecords(std::string &output)
+{
+	USE_DEBUGGER;
+	size_t	offset = 0;
+
+	while (_in.size() - offset >= FCGI_HEADER_SIZE)
+	{
+		const unsigned char	*header = (const unsigned char *) _in.data() + offset;
+		size_t	length = (header[4] << 8) | header[5];
+		size_t	total = FCGI_HEADER_SIZE + length + header[6];
+
+		if (header[0] != FCGI_VERSION_1)
+			return false;
+		if (_in.size() - offset < total)
+			break ;
+		if (header[1] == FCGI_STDOUT)
+			output.append(_in, offset + FCGI_HEADER_SIZE, length);
+		else if (header[1] == FCGI_STDERR && length)
+			debugger.warning("FastCGI: " + _in.substr(offset + FCGI_HEADER_SIZE, length));
+		else if (header[1] == FCGI_END_REQUEST)
+			_ended = true;
+		offset += total;
+	}
+	_in.erase(0, offset);
+	return true;
+}
+
+/**
+ * @brief Encodes a record header and its content, padded to 8 bytes
+ */
+void	FastCgiConnection::appendRecord(unsigned char type, const char *content, size_t length)
+{
+	unsigned char	padding = (8 - length % 8) % 8;
+	char			header[FCGI_HEADER_SIZE] = {FCGI_VERSION_1, (char) type, 0, FCGI_REQUEST_ID,
+		(char) ((length >> 8) & 0xff), (char) (length & 0xff), (char) padding, 0};
+
+	_out.append(header, FCGI_HEADER_SIZE);
+	if (length)
+		_out.append(content, length);
+	_out.append(padding, '\0');
+}
+
+/**
+ * @brief Encodes a name-value pair, lengths below 128 take one byte, the others four
+ */
+void	FastCgiConnection::appendParam(const std::string &name, const std::string &value, std::string &params)
+{
+	const std::string	*parts[2] = {&name, &value};
+
+	for (int i = 0; i < 2; i++)
+	{
+		size_t	length = parts[i]->size();
+		if (length < 128)
+			params += (char) length;
+		else
+		{
+			params += (char) (((length >> 24) & 0x7f) | 0x80);
+			params += (char) ((length >> 16) & 0xff);
+			params += (char) ((length >> 8) & 0xff);
+			params += (char) (length & 0xff);
+		}
+	}
+	params += name;
+	params += value;
+}
+
+/**
+ * @brief Gives the connection back to the pool if the request ended cleanly, closes it otherwise
+ * @param abort the client does not want the rest of the answer (timeout, client gone)
+ */
+void	FastCgiConnection::finish(bool abort)
+{
+	if (_fd < 0)
+		return ;
+	if (!abort && _ended && _stdin_closed && _out.empty() && _in.empty())
+		FastCgiPool::getInstance().release(_address, _fd);
+	else
+		close(_fd);
+	_fd = -1;
+	_spool = BodySpool();
+	_body.clear();
+}
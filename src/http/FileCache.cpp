@@ -0,0 +1,128 @@
+#include "../../inc/http/FileCache.hpp"
+#include "../../inc/http/Response.hpp"
+#include "../../inc/debugger/DebuggerPrinter.hpp"
+
+FileCache::FileCache() : _max_size((size_t) DEFAULT_FILE_CACHE_SIZE * 1000000), _size(0), _check_interval(DEFAULT_FILE_CACHE_CHECK_INTERVAL)
+{
+}
+
+FileCache::~FileCache()
+{
+}
+
+/**
+ * @brief Sets the limits of the cache. Entries above the new size are dropped right away.
+ * @param max_size bytes the cached files may use in total, 0 disables the cache
+ * @param check_interval seconds a cached file is used without checking the file on disk
+ */
+void	FileCache::configure(size_t max_size, int check_interval)
+{
+	_max_size = max_size;
+	_check_interval = check_interval;
+	shrink();
+}
+
+/**
+ * @brief Returns the cached file at path. Loads it on a miss, if it is small enough to be cached.
+ * @return NULL if the file is not cacheable (missing, no regular file, too big or the cache is disabled)
+ */
+const CachedFile	*FileCache::get(const std::string &path)
+{
+	struct stat	st;
+	time_t		now = std::time(NULL);
+
+	std::map<std::string, CachedFile>::iterator it = _entries.find(path);
+	if (it != _entries.end())
+	{
+		CachedFile	&entry = (*it).second;
+		if (now - entry.checked_at < _check_interval
+			|| (!stat(path.c_str(), &st) && st.st_ino == entry.inode && st.st_mtime == entry.mtime && st.st_size == entry.size))
+		{
+			if (now - entry.checked_at >= _check_interval)
+				entry.checked_at = now;
+			_lru.splice(_lru.begin(), _lru, entry.lru); // most recently used
+			return &entry;
+		}
+		evict(it); // changed or removed on disk
+	}
+	if (!_max_size || stat(path.c_str(), &st) || !S_ISREG(st.st_mode)
+		|| st.st_size > FILE_CACHE_MAX_ENTRY_SIZE || (size_t) st.st_size > _max_size)
+		return NULL;
+	if (!load(path, st))
+		return NULL;
+	shrink();
+	it = _entries.find(path);
+	if (it == _entries.end())
+		return NULL;
+	return &(*it).second;
+}
+
+/**
+ * @brief Reads the file into a new entry and precomputes its headers.
+ * @return false if the file could not be read completely
+ */
+bool	FileCache::load(const std::string &path, const struct stat &st)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+	std::string	content;
+	content.resize(st.st_size);
+	ssize_t got = 0;
+	ssize_t ret = 1;
+	while (got < st.st_size && (ret = read(fd, (char*)content.data() + got, st.st_size - got)) > 0)
+		got += ret;
+	close(fd);
+	if (got != st.st_size)
+		return false;
+
+	CachedFile	&entry = _entries[path];
+	entry.content_type = Response::sniff_file_format(content);
+	entry.body = SharedBuffer(content);
+	entry.etag = makeEtag(st);
+	entry.last_modified = makeHttpDate(st.st_mtime);
+	entry.inode = st.st_ino;
+	entry.mtime = st.st_mtime;
+	entry.size = st.st_size;
+	entry.checked_at = std::time(NULL);
+	_lru.push_front(path);
+	entry.lru = _lru.begin();
+	_size += st.st_size;
+	return true;
+}
+
+void	FileCache::evict(std::map<std::string, CachedFile>::iterator it)
+{
+	_size -= (*it).second.body.size();
+	_lru.erase((*it).second.lru);
+	_entries.erase(it);
+}
+
+/**
+ * @brief Drops the least recently used entries until the cache fits into its size
+ */
+void	FileCache::shrink()
+{
+	while (_size > _max_size && !_lru.empty())
+		evict(_entries.find(_lru.back()));
+}
+
+/**
+ * @brief Builds the entity tag out of inode, size and modification time, like "1a2b-1f4-5f3c2d1e"
+ */
+std::string	FileCache::makeEtag(const struct stat &st)
+{
+	std::stringstream	ss;
+	ss << "\"" << std::hex << st.st_ino << "-" << st.st_size << "-" << st.st_mtime << "\"";
+	return ss.str();
+}
+
+/**
+ * @brief Formats a time as HTTP date, like "Sun, 06 Nov 1994 08:49:37 GMT"
+ */
+std::string	FileCache::makeHttpDate(time_t time)
+{
+	char	buffer[64];
+	size_t	len = strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", gmtime(&time));
+	return std::string(buffer, len);
+}
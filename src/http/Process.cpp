@@ -1,21 +1,17 @@
 # include	"../../inc/http/Process.hpp"
 # include	"../../inc/debugger/DebuggerPrinter.hpp"
 
-Process::Process()
+Process::Process() : _with_cgi(false), _server(NULL), _location(NULL)
 {
 
 }
 
-Process::Process(Request request, ServerBlock config) : _request(request), _config(config)
+Process::Process(Request request, const VirtualServer &server) : _request(request), _server(&server), _location(NULL)
 {
 	_with_cgi = false;
-	_cgi_path = _config.getCgiPath();
-	_cgi_fileending = _config.getCgiFileEnding();
-	ConfigurationKey locationKey;
-	if (set_location_key_if_exists(locationKey)) {
-		_cgi_path = locationKey.cgi_path;
-		_cgi_fileending = locationKey.cgi_path;
-	}
+	_cgi_path = _server->cgi_path;
+	_cgi_fileending = _server->cgi_fileending;
+	match_location();
 	_server_name = request.getHost();
 }
 
@@ -24,14 +20,24 @@ Process::~Process(void)
 	USE_DEBUGGER;
 }
 
+/**
+ * @brief Copies the whole state, a client reuses its Process for every request of a persistent connection.
+ */
 Process & Process::operator = (const Process &src)
 {
+	_response = src._response;
+	_CGI = src._CGI;
 	_request = src._request;
-	_config = src._config;
+	_server = src._server;
+	_location = src._location;
+	_directory = src._directory;
 	_cgi_path = src._cgi_path;
 	_cgi_fileending = src._cgi_fileending;
+	_fastcgi_pass = src._fastcgi_pass;
 	_with_cgi = src._with_cgi;
 	_server_name = src._server_name;
+	_redirection = src._redirection;
+	_methods = src._methods;
 	return *this;
 }
 
@@ -62,56 +68,6 @@ void	Process::process_request(void)
 	}
 }
 
-/**
- * @brief Gets the path for a script or index file in a directory, but also checks if the request is a directory and handles it accordingly.
- * @return std::string 
- */
-std::string Process::getPathForNestedLocation()
-{
-	USE_DEBUGGER;
-	if (!_request.hasNestedRequestPath) { // if the path is not nested
-		if (_request.getScript().first.empty()) { // there is no additional script like /echo.php
-			return _config.getConfigurationKeysWithType(ROOT).front().root  + _request.getPath().first + "/" + _config.getConfigurationKeysWithType(INDEX).front().indexes.front();
-		} else { // there is a script file available like /echo.php
-			return _config.getConfigurationKeysWithType(ROOT).front().root + _request.getPath().first + "/" + _request.getScript().first;
-		}
-	} else { // we do not provide the index files for a nested path
-		// here we build the nested path for the location. this needs to be put in a seperate function later for sure...
-		// we use get_location to get the correct root path
-		std::string primaryLocation = get_first_location_in_path(_request.getPath().first); // where the nested folder is
-			// we need to add a slash to the location to get the correct root path and a slash after to match the location of the configuration file
-			// TODO Generate the full path for the nested path
-		std::string root = get_location(primaryLocation.insert(0, "/") + "/", ROOT);
-		// now append the rest of the path to the newly gained root path
-		std::string path = root +  "/" + _request.getPath().first.substr(primaryLocation.length());
-		if (_request.getScript().first.empty()) { // there is no additional script like /echo.php. Return the index file for the location of the nested path
-			return path + "/" + get_location(primaryLocation + "/", INDEX);
-		} else { // there is a script file available like /echo.php
-			return path + "/" + _request.getScript().first;
-		}
-	}
-}
-
-/**
- * @brief Returns the path with the index file defined in the configuration.
- * Will check every index file if available and accessible and chooses the first one that is accessible
- * @returns std::string path
- */
-std::string Process::build_path_with_index__or_script_file()
-{
-	USE_DEBUGGER;
-	if (_request.getPath().first == "/") { // the path is on the top level and not in any subdirectory
-		if (_request.getScript().first.empty()) { // there is no additional script like /echo.php
-			return _config.getConfigurationKeysWithType(ROOT).front().root + "/" + _config.getConfigurationKeysWithType(INDEX).front().indexes.front();
-		} else { // there is a script file available like /echo.php
-			return _config.getConfigurationKeysWithType(ROOT).front().root + "/" + _request.getScript().first;
-		}
-	} else {
-		// if it is not a nested path, we can just add the index file to the path or the script file
-		return getPathForNestedLocation();
-	}
-}
-
 /**
  * @brief Check if a request is too large for the server to handle
  * @param request 
@@ -119,8 +75,8 @@ std::string Process::build_path_with_index__or_script_file()
  */
 bool Process::check_if_request_is_too_large()
 {
-	if (_config.getConfigurationKeysWithType(POST_MAX_SIZE).size() > 0) {
-		if ((long) _request.getBody().first.size() > (_config.getConfigurationKeysWithType(POST_MAX_SIZE).front().post_max_size * 1000000))
+	if (_server->has_post_max_size) {
+		if (_request.getBodySize() > _server->post_max_size)
 		{
 			std::cout << "Request too big" << std::endl;
 			exception(413);
@@ -145,84 +101,78 @@ void	Process::handle_request(void)
 	// check if request is too large
 	if (check_if_request_is_too_large() == false)
 		return exception(413);
-	
-	// first we check if the request is too big
-	if (_request.getPath().first == "/") // if the script is the root path
+
+	if (!_location) // no location matches, the file is looked up below the root of the server
 	{
-		path = build_path_with_index__or_script_file(); // we return the file looked for or the index file
+		if (_request.getScript().first.empty()) // we return the file looked for or the index file
+			path = _server->root + "/" + _directory + _server->index;
+		else
+			path = _server->root + "/" + _directory + _request.getScript().first;
+		removeDoubleSlashesInUrl(path);
 		try {
 			build_response(path, "200", "OK");}
 		catch (int e){
+			if (e >= 500) // the cgi could not be started, that is not a missing file
+				throw (e);
 			debugger.error("UNABLE TO BUILD RESPONSE!");
 			throw(404);
 			return ;
 		}
 		return ;
 	}
-	else if (check_location()) // here we check if the location exists (target directory)
+	if (_request.getScript().first.empty()) // if no script is given
 	{
-		if (_request.getScript().first.empty()) // if no script is given
+		if (_location->directory_listing && _location->index.empty())
 		{
-			if (get_location_dl(_request.getPath().first.insert(0, "/")) && get_location(_request.getPath().first.insert(0, "/"), INDEX).empty())
-			{
-				if (find_vector(_methods, _request.getMethod().first) == -1)
-					throw (405);
-				try {
-					build_dl_response();
-				}
-				catch (int e){
-					debugger.error("Could not find the file listing script!");
-					throw(404);
-					return ;
-				}
+			if (find_vector(_methods, _request.getMethod().first) == -1)
+				throw (405);
+			try {
+				build_dl_response();
 			}
-			else // if not, we try to return the index file
-			{
-				path = get_location(_request.getPath().first.insert(0, "/"), ROOT) + "/" + get_location(_request.getPath().first.insert(0, "/"), INDEX);
-				if (find_vector(_methods, _request.getMethod().first) == -1)
-					throw (405);
-				try {
-					build_response(path, "200", "OK");}
-				catch (int e){
-					debugger.error("Could not find the index script!");
-					throw(404);
-					return ;
-				}
+			catch (int e){
+				if (e >= 500)
+					throw (e);
+				debugger.error("Could not find the file listing script!");
+				throw(404);
+				return ;
 			}
 		}
-		else
+		else // if not, we try to return the index file
 		{
-			path = get_location(_request.getPath().first.insert(0, "/"), ROOT) + "/" + _request.getScript().first;
+			path = _location->root + "/" + _directory + _location->index;
 			if (find_vector(_methods, _request.getMethod().first) == -1)
 				throw (405);
-			if (is_file_accessible(path))
-			{
-				try {
-					build_response(path, "200", "OK");}
-				catch (int e){
-					throw(401);
-					return ;
-				}
-			}
-			else
-			{
-				throw(401);
+			try {
+				build_response(path, "200", "OK");}
+			catch (int e){
+				if (e >= 500)
+					throw (e);
+				debugger.error("Could not find the index script!");
+				throw(404);
 				return ;
 			}
 		}
 	}
 	else
 	{
-		// nested directory
-		path = build_path_with_index__or_script_file();
+		path = _location->root + "/" + _directory + _request.getScript().first;
 		removeDoubleSlashesInUrl(path);
-		//if (find_vector(_methods, _request.getMethod().first) == -1)
-		//	throw (405);
-		try {
-			build_response(path, "200", "OK");}
-		catch (int e){
-			debugger.error("UNABLE TO BUILD RESPONSE!");
-			throw(404);
+		if (find_vector(_methods, _request.getMethod().first) == -1)
+			throw (405);
+		if (is_file_accessible(path))
+		{
+			try {
+				build_response(path, "200", "OK");}
+			catch (int e){
+				if (e >= 500)
+					throw (e);
+				throw(401);
+				return ;
+			}
+		}
+		else
+		{
+			throw(401);
 			return ;
 		}
 	}
@@ -302,21 +252,31 @@ void	Process::build_response(std::string path, std::string code, std::string sta
 		// This is where cgi is recognized
 		if (detectCgi(path, code, status)) // checks if the file ending has the cgi fileending, if yes, the request is targeted to the cgi
 		{
-			_with_cgi = true;
 			_CGI = CGI(_request, _server_name, path, _cgi_path); // activates the cgi
-			_CGI.set_tmps(); // sets the tmps for the cgi, so we can output and input to and from the cgi
+			if (!_fastcgi_pass.empty()) // the script is run by the FastCGI server
+			{
+				_CGI.set_fastcgi_pass(_fastcgi_pass);
+				_CGI.start_fastcgi();
+				_with_cgi = true; // only once connected, a 502 of start_fastcgi is sent like any error page
+				return ;
+			}
+			_CGI.set_input(); // the body becomes the stdin of the cgi
+			_with_cgi = true; // only once the input is ready, a 500 or 503 of set_input is sent like any error page
 			return ;
 		}
 		else // the request is not cgi or redirection, so we just return the content of the file at the location of path.
 		{
 			// the request is a static file
 			try {
-				_response.set_body(get_file_content_for_request(path)); // still ok
+				const CachedFile *cached = FileCache::getInstance().get(path);
+				if (cached)
+					_response.set_cached_body(*cached);
+				else if (!_response.set_body_file(path)) // big files are sent straight from the file
+					_response.set_body(get_file_content_for_request(path)); // still ok
 			} catch (int e) {
 				throw (404);
 			}
 		}
-		_response.set_content_length(to_str(_response.get_body().length()));
 		_response.set_content_type(_response.get_file_format());
 	}
 	_response.create_response();
@@ -332,15 +292,58 @@ void	Process::server_overloaded(void)
 }
 
 /**
- * @brief builds the response in case of a cgi
+ * @brief builds the response in case of a cgi out of the header fields the script printed.
+ * "Status" sets the status line, a "Location" without status is a redirection (302),
+ * the framing of the body (length, transfer coding, connection) is up to us, the other fields are passed on.
+ * @param headers the header fields of the cgi output, without the empty line
+ * @param body the output behind the header fields, taken over if the body is complete
+ * @param chunked the rest of the body follows while the script runs, otherwise body is the whole body
  */
-void	Process::build_cgi_response(void)
+void	Process::build_cgi_response(const std::string &headers, std::string &body, bool chunked)
 {
-	std::string tmp;
-	tmp = _CGI.get_buf();
-	_response.set_body(tmp);
-	_response.set_content_length(to_str(_response.get_body().length()));
-	_response.set_content_type(_response.get_file_format());
+	std::istringstream	lines(headers);
+	std::string			raw;
+	std::string			content_type;
+	bool				has_status = false;
+	bool				has_location = false;
+
+	for (std::string line; std::getline(lines, line); )
+	{
+		if (!line.empty() && line[line.length() - 1] == '\r')
+			line.erase(line.length() - 1);
+		size_t colon = line.find(':');
+		if (colon == std::string::npos)
+			continue ;
+		std::string name = lower_str_ret(line.substr(0, colon));
+		std::string value = line.substr(colon + 1);
+		value.erase(0, value.find_first_not_of(" \t"));
+		if (name == "status")
+		{
+			has_status = true;
+			_response.set_status_code(value.substr(0, 3));
+			_response.set_status_text(value.length() > 4 ? value.substr(4) : "");
+			continue ;
+		}
+		if (name == "content-type")
+			content_type = value;
+		if (name == "content-type" || name == "content-length" || name == "transfer-encoding" || name == "connection")
+			continue ;
+		has_location |= (name == "location");
+		if (!raw.empty())
+			raw += "\r\n";
+		raw += line;
+	}
+	if (has_location && !has_status)
+	{
+		_response.set_status_code("302");
+		_response.set_status_text("Found");
+	}
+	_response.set_content_type(content_type.empty() ? Response::sniff_file_format(body) : content_type);
+	_response.set_headers_raw(raw);
+	if (chunked)
+		_response.set_transfer_encoding("chunked");
+	else
+		_response.set_body(body);
 	_response.create_response();
 }
 
@@ -351,125 +354,65 @@ void	Process::build_cgi_response(void)
 void	Process::build_dl_response(void)
 {
 	std::string	directory;
-	std::string cgi_path = _config.getCgiPath();
 	char	tmp[1000];
 	getcwd(tmp, 1000);
 	std::string abs(tmp);
-	directory = abs + "/" + get_location(_request.getPath().first.insert(0, "/"), ROOT) + "/";
-	try {
-		_request.setBody(directory);
-	} catch (int e) {
-		throw (404);
-	}
+	directory = abs + "/" + _location->root + "/" + _directory;
 	_response.set_protocol("HTTP/1.1");
 	_response.set_status_code("200");
-	_response.set_server(_config.getConfigurationKeysWithType(SERVER_NAME).front().server_names.front());
-	_with_cgi = true;
+	_response.set_server(_server->server_name);
 	_CGI = CGI(_request, _server_name, "./resources/directory_listing/directory_listing.php", "php-cgi");
 	_CGI.location_dl = directory;
-	_CGI.set_tmps();
+	_CGI.set_input();
+	_with_cgi = true;
 }
 
 
 /**
- * @brief Sets it to the configuration key, if the location key exists
- * @param &location
+ * @brief Finds the location of the request once and takes over its settings.
+ * A location without cgi settings does not run the cgi of the server block.
  */
-bool	Process::set_location_key_if_exists(ConfigurationKey &location)
+void	Process::match_location(void)
 {
-	std::vector<ConfigurationKey>	locations = _config.getConfigurationKeysWithType(LOCATION);
-	std::vector<ConfigurationKey>::iterator	it;
-	for (it = locations.begin(); it != locations.end(); it++)
-	{
-		std::string	request_path = _request.getPath().first.insert(0, "/");
-		
-		if (!(*it).value.compare(request_path))
-		{
-			location = *it;
-			return true;
-		}
-	}
-	return false;
-}
+	std::string	directory = "/" + _request.getPath().first;
+	std::string	script = _request.getScript().first;
+	size_t		matched = 0;
 
-/**
- * @brief checks if the given location exists
- */
-bool	Process::check_location(void)
-{
-	std::vector<ConfigurationKey>	locations = _config.getConfigurationKeysWithType(LOCATION);
-	std::vector<ConfigurationKey>::iterator	it;
-	for (it = locations.begin(); it != locations.end(); it++)
-	{
-		std::string	request_path = _request.getPath().first.insert(0, "/");
-		
-		if (!(*it).value.compare(request_path))
-		{
-			return true;
-		}
-	}
-	return false;
-}
-
-/**
- * @brief gets all the information of a given location
- */
-std::string	Process::get_location(std::string location, ConfigurationKeyType type)
-{
-	std::vector<ConfigurationKey>	vec = _config.getConfigurationKeysWithType(LOCATION);
-	std::vector<ConfigurationKey>::iterator	it;
-	std::string	path;
-	for (it = vec.begin(); it != vec.end(); it++)
-	{
-		if (!(*it).value.compare(location))
-		{
-			if (!(*it).cgi_path.empty())
-				_cgi_path = (*it).cgi_path; 
-			if (!(*it).cgi_fileending.empty())
-				_cgi_fileending = (*it).cgi_fileending;
-			if (!(*it).redirection.empty())
-				_redirection = (*it).redirection;
-			if (!(*it).allowedMethods.empty())
-				_methods = (*it).allowedMethods;
-			if (type == ROOT)
-				return (*it).root;
-			else if (type == INDEX)
-			{
-				if ((*it).indexes.empty())
-				{
-					std::string empty;
-					return empty;
-				}
-				return (*it).indexes.front();
-			}
-		}
-	}
-	return path;
-}
-
-bool	Process::get_location_dl(std::string location)
-{
-	std::vector<ConfigurationKey>	vec = _config.getConfigurationKeysWithType(LOCATION);
-	std::vector<ConfigurationKey>::iterator	it;
-	for (it = vec.begin(); it != vec.end(); it++)
-	{
-		if (!(*it).value.compare(location))
-			return (*it).directory_listing;
-	}
-	return false;
+	removeDoubleSlashesInUrl(directory);
+	if (directory[directory.length() - 1] != '/')
+		directory += "/";
+	script = script.substr(0, script.find('?'));
+	if (!script.empty() && script[0] == '/')
+		script.erase(0, 1);
+	_location = _server->matchLocation(directory + script, matched);
+	_directory = directory.substr(std::min(_location ? matched : 1, directory.length()));
+	if (!_location)
+		return ;
+	_cgi_path = _location->cgi_path;
+	_cgi_fileending = _location->cgi_fileending;
+	_fastcgi_pass = _location->fastcgi_pass;
+	_redirection = _location->redirection;
+	_methods = _location->methods;
 }
 
 /**
  * @brief If an exception is thrown, we have the option to return a error page that fits.
+ * The common errors are answered with the response pre-rendered by the server block, the others are built here.
  * @param e 
  */
 void	Process::exception(int e)
 {
+	SharedBuffer	page = _server->block.getErrorResponse(e, _response.get_connection() == "keep-alive");
+	if (!page.empty() && _redirection.empty())
+	{
+		_response.set_prerendered(page);
+		return ;
+	}
 	switch (e)
 	{
 		case 404:
 			try {
-				build_response(_config.getErrorPagePathForCode(404), "404", "Not Found");
+				build_response(_server->block.getErrorPagePathForCode(404), "404", "Not Found");
 			}
 			catch (int e) {
 				throw (e);
@@ -477,7 +420,7 @@ void	Process::exception(int e)
 			break;
 		case 405:
 			try {
-				build_response(_config.getErrorPagePathForCode(405), "405", "Method not allowed");
+				build_response(_server->block.getErrorPagePathForCode(405), "405", "Method not allowed");
 			}
 			catch (int e) {
 				throw (e);
@@ -485,7 +428,7 @@ void	Process::exception(int e)
 			break;
 		case 500:
 			try {
-				build_response(_config.getErrorPagePathForCode(500), "500", "Internal server error");
+				build_response(_server->block.getErrorPagePathForCode(500), "500", "Internal server error");
 			}
 			catch (int e) {
 				throw (e);
@@ -493,7 +436,7 @@ void	Process::exception(int e)
 			break;
 		case 501:
 			try {
-				build_response(_config.getErrorPagePathForCode(501), "501", "Not implemented");
+				build_response(_server->block.getErrorPagePathForCode(501), "501", "Not implemented");
 			}
 			catch (int e) {
 				throw (e);
@@ -501,7 +444,7 @@ void	Process::exception(int e)
 			break;
 		case 413:
 			try {
-				build_response(_config.getErrorPagePathForCode(413), "413", "Request too big");
+				build_response(_server->block.getErrorPagePathForCode(413), "413", "Request too big");
 			}
 			catch (int e) {
 				throw (e);
@@ -509,7 +452,7 @@ void	Process::exception(int e)
 			break;
 		case 502:
 			try {
-				build_response(_config.getErrorPagePathForCode(502), "502", "Bad gateway");
+				build_response(_server->block.getErrorPagePathForCode(502), "502", "Bad gateway");
 			}
 			catch (int e) {
 				throw (e);
@@ -517,7 +460,7 @@ void	Process::exception(int e)
 			break;
 		case 504:
 			try {
-				build_response(_config.getErrorPagePathForCode(504), "504", "Gateway timeout");
+				build_response(_server->block.getErrorPagePathForCode(504), "504", "Gateway timeout");
 			}
 			catch (int e) {
 				throw (e);
@@ -525,7 +468,7 @@ void	Process::exception(int e)
 			break;
 		default:
 			try {
-				build_response(_config.getErrorPagePathForCode(404), "404", "Server not available");
+				build_response(_server->block.getErrorPagePathForCode(404), "404", "Server not available");
 			}
 			catch (int e) {
 				throw (e);
@@ -1,6 +1,7 @@
 
 #include "../../inc/http/Request.hpp"
 #include "../../inc/debugger/DebuggerPrinter.hpp"
+#include <cstdlib>
 
 
 /**
@@ -17,8 +18,13 @@ Request::Request() :
 	_query("", false),
 	_fragment("", false),
 	_httpVersion("HTTP/1.1", true),
-	_headers(),
-	_body("", false)
+	_head(),
+	_fields(),
+	_content_length(0),
+	_chunked(false),
+	_body("", false),
+	_spool(),
+	_body_size(0)
 	{}
 
 /**
@@ -28,27 +34,39 @@ Request::Request( const Request &src ) :
 	hasNestedRequestPath(src.hasNestedRequestPath),
 	_method(src._method),
 	_protocol(src._protocol),
+	_domain(src._domain),
 	_port(src._port),
 	_script(src._script),
 	_path(src._path),
 	_query(src._query),
 	_fragment(src._fragment),
 	_httpVersion(src._httpVersion),
-	_headers(src._headers),
-	_body(src._body)  {}
+	_head(src._head),
+	_fields(src._fields),
+	_content_length(src._content_length),
+	_chunked(src._chunked),
+	_body(src._body),
+	_spool(src._spool),
+	_body_size(src._body_size)  {}
 
 Request & Request::operator = (const Request &rhs)
 {
 	_method = rhs._method;
 	_protocol = rhs._protocol;
+	_domain = rhs._domain;
 	_port = rhs._port;
 	_script = rhs._script;
 	_path = rhs._path;
 	_query = rhs._query;
 	_fragment = rhs._fragment;
 	_httpVersion = rhs._httpVersion;
-	_headers = rhs._headers;
+	_head = rhs._head;
+	_fields = rhs._fields;
+	_content_length = rhs._content_length;
+	_chunked = rhs._chunked;
 	_body = rhs._body;
+	_spool = rhs._spool;
+	_body_size = rhs._body_size;
 	hasNestedRequestPath = rhs.hasNestedRequestPath;
 	return *this;
 }
@@ -72,29 +90,57 @@ str_flag			Request::getQuery() const { return _query; }
 
 str_flag			Request::getFragment() const	{ return _fragment; }
 str_flag			Request::getHttpversion() const	{ return _httpVersion; }
-headr_dirctiv		Request::getHeaders() const		{ return _headers; }
 str_flag			Request::getBody() const		{ 
 	return _body;
 }
+unsigned long		Request::getContentLength() const	{ return _content_length; }
+bool				Request::isChunked() const			{ return _chunked; }
+size_t				Request::getBodySize() const		{ return _body_size; }
+const BodySpool		&Request::getSpool() const			{ return _spool; }
 
 /**
- * @brief Main parsing function, each subfunction will
- * parse and store a specific element of the request and erase it
- * in the request string.
+ * @brief Returns a copy of all header fields, only meant for printing the request
  */
-void Request::parser(std::string &req) {
+headr_dirctiv		Request::getHeaders() const
+{
+	headr_dirctiv	headers;
+
+	for (size_t i = 0; i < _fields.size(); i++)
+		headers.push_back(std::make_pair(str_flag(slice(_fields[i].name), true), str_flag(slice(_fields[i].value), true)));
+	return headers;
+}
+
+/**
+ * @brief Returns the part of the raw head
+ */
+std::string			Request::slice(const HeadSlice &slice) const
+{
+	return _head.substr(slice.offset, slice.length);
+}
+
+/**
+ * @brief Main parsing function, takes over the head found by the parser
+ * and stores every element of the request line.
+ * The header fields stay slices of the head, only the ones webserv needs are checked.
+ * @param head first byte of the head, the parser reported PARSE_COMPLETE for it
+ * @throw int status code if the request can not be served (400 or 501)
+ */
+void Request::parse(const char *head, const RequestParser &parser) {
 	USE_DEBUGGER;
-	if (req.empty())
-		throw (Bad_Request);
+	_head.assign(head, parser.getHeadSize());
+	_fields = parser.getFields();
 	try {
-		setMethod(req);
-		setUrl(req);
-		setHttpversion(req);
-		setHeaders(req);
-		setBody(req);
+		setMethod(slice(parser.getMethod()));
+		std::string url = slice(parser.getTarget());
+		setUrl(url);
+		setHttpversion(slice(parser.getVersion()));
+		for (size_t i = 0; i < _fields.size(); i++)
+			checkHeader(_fields[i]);
+		if (_chunked && !findHeader(Content_Length).empty()) // the length of the body would be ambiguous (RFC 9112 6.1)
+			throw (400);
 	}
-	catch (std::string status) {
-		debugger.verbose(status);
+	catch (int status) {
+		debugger.verbose("Invalid request head: " + to_str(status));
 		throw (status);
 	}
 }
@@ -102,17 +148,11 @@ void Request::parser(std::string &req) {
 /**
  * @brief Check the method in the request, and verify if supported
  */
-void Request::setMethod(std::string &req) {
-	std::string tmp;
-	size_t pos = req.find(" ");
-	if (pos == std::string::npos)
-		throw(Bad_Request);
-	tmp = req.substr(0, pos);
-	if (!tmp.compare("GET"))			{ _method.first = GET; _method.second = true; }
-	else if (!tmp.compare("POST"))		{ _method.first = POST; _method.second = true; }
-	else if (!tmp.compare("DELETE"))	{ _method.first = DELETE; _method.second = true; }
-	else { _method.first = UNKNOWN; _method.second = false; throw(Method_Not_Allowed); }
-	req.erase(0, pos + 1);
+void Request::setMethod(const std::string &method) {
+	if (!method.compare("GET"))				{ _method.first = GET; _method.second = true; }
+	else if (!method.compare("POST"))		{ _method.first = POST; _method.second = true; }
+	else if (!method.compare("DELETE"))		{ _method.first = DELETE; _method.second = true; }
+	else { _method.first = UNKNOWN; _method.second = false; throw(501); }
 }
 
 /**
@@ -134,12 +174,7 @@ std::string Request::getMethodasString()
 /**
  * @brief Separate the different element in the URL of the request
  */
-void Request::setUrl(std::string &req) {
-	size_t pos = req.find(" ");
-	if (pos == std::string::npos)
-		throw(Bad_Request);
-	std::string url = req.substr(0, pos);
-	req.erase(0, pos + 1);
+void Request::setUrl(std::string &url) {
 	removeDoubleSlashesInUrl(url);
 	// if path does not end with file ending, add a slash if there is not a path already
 	if (url.find('.') == std::string::npos && url.find('/') == std::string::npos)
@@ -175,7 +210,7 @@ void Request::setDomain(std::string &url) {
 	{
 		_domain.first.clear();
 		_domain.second = false;
-		throw(Bad_Request);
+		throw(400);
 	}
 	_domain.first = url.substr(0, pos);
 	url.erase(0, pos + 1);
@@ -200,7 +235,7 @@ void Request::setPort(std::string &url) {
 	if (_port.first < 0)
 	{
 		_port.second = false;
-		throw(Bad_Request);
+		throw(400);
 	}
 	url.erase(x, y - x );
 	debugger.debug(url);
@@ -327,16 +362,10 @@ void Request::setFragment(std::string &url) {
 /**
  * @brief Check the HTTP version used in the request. Webserv support only HTTP/1.1
  */
-void Request::setHttpversion(std::string &req)
+void Request::setHttpversion(const std::string &version)
 {
-	size_t pos = req.find("\n");
-
-	_httpVersion.first = req.substr(0, pos);
-	if(!_httpVersion.first.compare("HTTP/1.1"))
-		_httpVersion.second = true;
-	else
-		_httpVersion.second = false;
-	req.erase(0, pos + 1);
+	_httpVersion.first = version;
+	_httpVersion.second = !version.compare("HTTP/1.1");
 }
 
 // TODO support presence of ':' inside body
@@ -371,49 +400,28 @@ std::string Request::getHost() {
 	return host;
 }
 
-/*
- * @brief Store every single header in a vector of pair
- * vector -> <header: directive>
- * 			header -> <header, flag>
- *			directive -> <directive, flag>
- */
-void Request::setHeaders(std::string &req)
-{
-	// std::cout << "req_header: " << req << std::endl;
-	str_flag hdr, direct;
-	size_t end = req.find("\r\n\r\n");
-	// std::cout << "end: " << end << std::endl;
-	size_t pos = req.find(":");
-	while (pos != std::string::npos && pos < end)
-	{
-		hdr = std::make_pair(req.substr(0, pos), true);
-		req.erase(0, pos + 1);
-		pos = req.find("\n");
-		direct = std::make_pair(req.substr(0, pos), true);
-		checkHeader(hdr, direct);
-		_headers.push_back(std::make_pair(hdr, direct));
-		req.erase(0, pos + 1);
-		pos = req.find(":");
-		end = req.find("\r\n");
-	}
-}
-
 /**
  * @brief Check if the header is valid
- * 
- * @param hdr 
- * @param direct 
+ * The content length has to be a number and may only be repeated with the same value (RFC 9112 6.3).
+ * The only transfer coding supported is chunked.
  */
-void Request::checkHeader(str_flag &hdr, str_flag &direct)
+void Request::checkHeader(const HeaderField &field)
 {
-	if (hdr.first == Host)
+	if (isField(field, Host))
 	{
-		std::string host_header = direct.first;
+		std::string host_header = slice(field.value);
 		removeDoubleSlashesInUrl(host_header);
 		setPort(host_header);
 	}
-	if (hdr.first == Content_Length)
+	if (isField(field, Content_Length))
 	{
+		std::string value = slice(field.value);
+		if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos || value.length() > 18)
+			throw (400);
+		unsigned long length = std::strtoul(value.c_str(), NULL, 10);
+		if (_content_length && _content_length != length)
+			throw (400);
+		_content_length = length;
 		if (_method.first != DELETE && _method.first != POST)
 		{
 			_method.second = false;
@@ -421,29 +429,56 @@ void Request::checkHeader(str_flag &hdr, str_flag &direct)
 		}
 		//check max content length from the parsed config file
 	}
-	//if (hdr.first == Content_Type)
+	if (isField(field, Transfer_Encoding))
+	{
+		if (lower_str_ret(slice(field.value)) != "chunked") // chunked is the only transfer coding we decode
+			throw (501);
+		_chunked = true;
+	}
 }
 
 /**
- * @brief Sets the body of the request. Will throw an Forbidden for a GET request when a body is present.
- * @param req 
+ * @brief Appends the next bytes of the body, they arrive in pieces.
+ * Small bodies are kept in memory, once the body grows beyond BODY_MEMORY_LIMIT
+ * it is moved to the spool file and the following bytes are written there as they arrive.
+ * Will throw an Forbidden for a GET request when a body is present.
  */
-void Request::setBody(std::string &req)
+void Request::appendBody(const char *data, size_t size)
 {
-	size_t pos = req.find("\n");
-	if (pos != std::string::npos && _method.first == GET) // you cannot provide a body when using GET!
+	if (size && _method.first == GET) // you cannot provide a body when using GET!
 	{
 		_method.second = false;
-		throw (Forbidden);
+		throw (403);
 	}
-	if (pos != std::string::npos)
+	_body_size += size;
+	if (!_spool.isOpen() && _body.first.size() + size <= BODY_MEMORY_LIMIT)
 	{
-		_body.first = req.substr(pos + 1, req.length());
-		_body.second = true;
-	} else 
+		_body.first.append(data, size);
+		_body.second = !_body.first.empty();
+		return ;
+	}
+	if (!_spool.isOpen())
+	{
+		if (!_spool.open() || !_spool.append(_body.first.data(), _body.first.size()))
+			throw (500);
+		std::string().swap(_body.first);
 		_body.second = false;
-	//if (req.length())
-	//	req.erase(pos);
+	}
+	if (!_spool.append(data, size))
+		throw (500);
+}
+
+/**
+ * @brief Compares the name of the header field case insensitive, without copying it
+ */
+bool Request::isField(const HeaderField &field, const std::string &name) const
+{
+	if (field.name.length != name.length())
+		return false;
+	for (size_t i = 0; i < name.length(); i++)
+		if (std::tolower((unsigned char)_head[field.name.offset + i]) != std::tolower((unsigned char)name[i]))
+			return false;
+	return true;
 }
 
 /**
@@ -451,14 +486,12 @@ void Request::setBody(std::string &req)
  */
 std::string	Request::findHeader(std::string key) const
 {
-	std::string null;
-	headr_dirctiv::const_iterator	it;
-	for (it = _headers.begin(); it != _headers.end(); it++)
+	for (size_t i = 0; i < _fields.size(); i++)
 	{
-		if ( lower_str_ret((*it).first.first) == lower_str_ret(key) )
-			return (*it).second.first;
+		if (isField(_fields[i], key))
+			return slice(_fields[i].value);
 	}
-	return null;
+	return std::string();
 }
 
 /**
@@ -0,0 +1,234 @@
+#include "../../inc/http/RequestParser.hpp"
+#include <cstring>
+#include <cctype>
+
+RequestParser::RequestParser()
+{
+	reset();
+}
+
+RequestParser::RequestParser(const RequestParser &src)
+{
+	*this = src;
+}
+
+RequestParser &RequestParser::operator=(const RequestParser &rhs)
+{
+	_state = rhs._state;
+	_pos = rhs._pos;
+	_mark = rhs._mark;
+	_value_end = rhs._value_end;
+	_error = rhs._error;
+	_method = rhs._method;
+	_target = rhs._target;
+	_version = rhs._version;
+	_field = rhs._field;
+	_fields = rhs._fields;
+	return *this;
+}
+
+RequestParser::~RequestParser()
+{
+}
+
+/**
+ * @brief Forgets the parsed head, the next call of parse() starts at the first byte of the buffer
+ */
+void	RequestParser::reset()
+{
+	HeadSlice	empty = {0, 0};
+
+	_state = S_START;
+	_pos = 0;
+	_mark = 0;
+	_value_end = 0;
+	_error = 0;
+	_method = empty;
+	_target = empty;
+	_version = empty;
+	_field.name = empty;
+	_field.value = empty;
+	_fields.clear();
+}
+
+int									RequestParser::getError() const		{ return _error; }
+size_t								RequestParser::getHeadSize() const	{ return _pos; }
+const HeadSlice						&RequestParser::getMethod() const	{ return _method; }
+const HeadSlice						&RequestParser::getTarget() const	{ return _target; }
+const HeadSlice						&RequestParser::getVersion() const	{ return _version; }
+const std::vector<HeaderField>		&RequestParser::getFields() const	{ return _fields; }
+
+/**
+ * @brief Continues parsing at the first byte which was not seen yet.
+ * data has to start with the same bytes as on the previous calls, only new bytes may be appended.
+ * Lines may end with \r\n or a bare \n, empty lines in front of the request line are ignored (RFC 9112 2.2).
+ * @return PARSE_COMPLETE once the empty line behind the headers was found,
+ * PARSE_ERROR with the status code in getError() (400, 414, 431, 505) or PARSE_NEED_MORE
+ */
+ParseStatus	RequestParser::parse(const char *data, size_t size)
+{
+	if (_error)
+		return PARSE_ERROR;
+	if (_state == S_DONE)
+		return PARSE_COMPLETE;
+	for (; _pos < size; _pos++)
+	{
+		char	c = data[_pos];
+
+		if (_state < S_FIELD_START && _pos >= REQUEST_LINE_MAXIMUM_SIZE)
+			return fail(414);
+		if (_pos >= REQUEST_HEAD_MAXIMUM_SIZE)
+			return fail(431);
+		if (_state == S_START)
+		{
+			if (c == '\r' || c == '\n')
+				continue ;
+			_mark = _pos;
+			_state = S_METHOD;
+		}
+		if (_state == S_METHOD)
+		{
+			if (c == ' ')
+			{
+				if (_pos == _mark)
+					return fail(400);
+				_method.offset = _mark;
+				_method.length = _pos - _mark;
+				_mark = _pos + 1;
+				_state = S_TARGET;
+			}
+			else if (!isToken(c))
+				return fail(400);
+		}
+		else if (_state == S_TARGET)
+		{
+			if (c == ' ')
+			{
+				if (_pos == _mark)
+					return fail(400);
+				_target.offset = _mark;
+				_target.length = _pos - _mark;
+				_mark = _pos + 1;
+				_state = S_VERSION;
+			}
+			else if ((unsigned char)c <= ' ' || c == 0x7f)
+				return fail(400);
+		}
+		else if (_state == S_VERSION)
+		{
+			if (c == '\r' || c == '\n')
+			{
+				_version.offset = _mark;
+				_version.length = _pos - _mark;
+				if (int status = checkVersion(data))
+					return fail(status);
+				_state = (c == '\r') ? S_REQUEST_LINE_LF : S_FIELD_START;
+			}
+		}
+		else if (_state == S_REQUEST_LINE_LF || _state == S_FIELD_LF)
+		{
+			if (c != '\n')
+				return fail(400);
+			_state = S_FIELD_START;
+		}
+		else if (_state == S_FIELD_START)
+		{
+			if (c == '\r')
+				_state = S_HEAD_END_LF;
+			else if (c == '\n')
+			{
+				_pos++;
+				_state = S_DONE;
+				return PARSE_COMPLETE;
+			}
+			else if (!isToken(c)) // also rejects obsolete line folding (a line starting with a whitespace)
+				return fail(400);
+			else if (_fields.size() >= REQUEST_HEADERS_MAXIMUM)
+				return fail(431);
+			else
+			{
+				_field.name.offset = _pos;
+				_state = S_FIELD_NAME;
+			}
+		}
+		else if (_state == S_FIELD_NAME)
+		{
+			if (c == ':')
+			{
+				_field.name.length = _pos - _field.name.offset;
+				_state = S_FIELD_VALUE_START;
+				continue ;
+			}
+			else if (!isToken(c)) // no whitespace allowed between the name and the colon
+				return fail(400);
+		}
+		else if (_state == S_HEAD_END_LF)
+		{
+			if (c != '\n')
+				return fail(400);
+			_pos++;
+			_state = S_DONE;
+			return PARSE_COMPLETE;
+		}
+		if (_state == S_FIELD_VALUE_START)
+		{
+			if (c == ' ' || c == '\t')
+				continue ;
+			_mark = _pos;
+			_value_end = _pos;
+			_state = S_FIELD_VALUE;
+		}
+		if (_state == S_FIELD_VALUE)
+		{
+			if (c == '\r' || c == '\n')
+			{
+				_field.value.offset = _mark;
+				_field.value.length = _value_end - _mark;
+				_fields.push_back(_field);
+				_state = (c == '\r') ? S_FIELD_LF : S_FIELD_START;
+			}
+			else if (c == ' ' || c == '\t')
+				continue ;
+			else if ((unsigned char)c < ' ' || c == 0x7f)
+				return fail(400);
+			else
+				_value_end = _pos + 1;
+		}
+	}
+	return PARSE_NEED_MORE;
+}
+
+/**
+ * @brief Remembers the error, the parser stays in this state until reset()
+ */
+ParseStatus	RequestParser::fail(int status)
+{
+	_error = status;
+	return PARSE_ERROR;
+}
+
+/**
+ * @brief Only HTTP/1.x is supported
+ * @return 0 if the version is valid, otherwise the status code to answer with
+ */
+int	RequestParser::checkVersion(const char *data) const
+{
+	const char	*version = data + _version.offset;
+
+	if (_version.length != 8 || std::memcmp(version, "HTTP/", 5)
+		|| !std::isdigit((unsigned char)version[5]) || version[6] != '.' || !std::isdigit((unsigned char)version[7]))
+		return 400;
+	if (version[5] != '1')
+		return 505;
+	return 0;
+}
+
+/**
+ * @brief tchar of RFC 9110 5.6.2, the characters allowed in a method and a header name
+ */
+bool	RequestParser::isToken(char c)
+{
+	if (std::isalnum((unsigned char)c))
+		return true;
+	return c && std::strchr("!#$%&'*+-.^_`|~", c);
+}
@@ -1,11 +1,6 @@
 # include "../../inc/http/Response.hpp"
 
-Response::Response(void)
-{
-
-}
-
-Response::Response(Request request, ServerBlock config) : _request(request), _config(config)
+Response::Response(void) : _body_fd(-1), _body_file_size(0)
 {
 
 }
@@ -24,7 +19,9 @@ void	Response::set_content_type(std::string content_type){_content_type = conten
 void	Response::set_charset(std::string charset){_charset = charset;}
 void	Response::set_content_length(std::string content_length){_content_length = content_length;}
 void	Response::set_transfer_encoding(std::string transfer_encoding){_transfer_encoding = transfer_encoding;}
-void	Response::set_body(std::string body){_body = body;}
+void	Response::set_connection(std::string connection){_connection = connection;}
+void	Response::set_body(std::string body){_body.swap(body);}
+void	Response::set_headers_raw(std::string headers_raw){_headers_raw = headers_raw;}
 
 std::string	Response::get_protocol(void){return _protocol;}
 std::string	Response::get_status_code(void){return _status_code;}
@@ -35,47 +32,161 @@ std::string	Response::get_content_type(void){return _content_type;}
 std::string	Response::get_charset(void){return _charset;}
 std::string	Response::get_content_length(void){return _content_length;}
 std::string	Response::get_transfer_encoding(void){return _transfer_encoding;}
+std::string	Response::get_connection(void){return _connection;}
 std::string	Response::get_body(void){return _body;}
 
-std::string	&Response::get_response(void)
+bool	Response::has_body_file(void){return _body_fd != -1;}
+size_t	Response::get_body_file_size(void){return _body_file_size;}
+
+/**
+ * @brief Uses the file at path as body, if it is big enough to be worth sending it straight from the file.
+ * Only the beginning of the file is read (to guess the content type), the file stays open until it is released.
+ * @return false if the file is smaller than SENDFILE_THRESHOLD (or no regular file), the caller reads it into the body then.
+ * @throw 404 if the file could not be opened
+ */
+bool	Response::set_body_file(std::string path)
+{
+	struct stat	st;
+	int			fd = open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+		throw 404;
+	if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size < SENDFILE_THRESHOLD)
+	{
+		close(fd);
+		return false;
+	}
+	_body_head.resize(FILE_FORMAT_SNIFF_SIZE);
+	ssize_t got = pread(fd, (char*)_body_head.data(), FILE_FORMAT_SNIFF_SIZE, 0);
+	_body_head.resize(got > 0 ? got : 0);
+	if (_body_fd != -1)
+		close(_body_fd);
+	_body_fd = fd;
+	_body_file_size = st.st_size;
+	_body.clear();
+	_etag = FileCache::makeEtag(st);
+	_last_modified = FileCache::makeHttpDate(st.st_mtime);
+	return true;
+}
+
+/**
+ * @brief Uses a file of the FileCache as body. The content is shared with the cache, not copied.
+ */
+void	Response::set_cached_body(const CachedFile &file)
+{
+	_shared_body = file.body;
+	_body.clear();
+	_body_head.clear();
+	_content_type = file.content_type;
+	_etag = file.etag;
+	_last_modified = file.last_modified;
+}
+
+/**
+ * @brief Uses a complete pre-rendered response (status line, headers and body), e.g. an error page of the server block.
+ * It is sent as it is, create_response must not be called afterwards.
+ */
+void	Response::set_prerendered(const SharedBuffer &response)
+{
+	if (_body_fd != -1)
+		close(_body_fd);
+	_body_fd = -1;
+	_head.clear();
+	_body.clear();
+	_shared_body = response;
+}
+
+/**
+ * @brief Returns the body shared with the FileCache or the pre-rendered response (empty otherwise)
+ */
+const SharedBuffer	&Response::get_shared_body(void)
+{
+	return _shared_body;
+}
+
+/**
+ * @brief Hands the body file over to the caller, who has to close it.
+ * @return the filedescriptor of the body file or -1
+ */
+int	Response::release_body_file(void)
+{
+	int	fd = _body_fd;
+	_body_fd = -1;
+	return fd;
+}
+
+/**
+ * @brief Returns the head of the response (status line and headers, terminated by an empty line)
+ */
+std::string	&Response::get_head(void)
 {
-	return _response;
+	return _head;
 }
 
+/**
+ * @brief Returns the body as it is sent after the head (empty if the body is sent from a file)
+ */
+std::string	&Response::get_payload(void)
+{
+	return _body;
+}
+
+/**
+ * @brief Builds the head of the response out of the status line and the headers.
+ * The body is not copied behind it, head and body are sent together with writev later on.
+ * The head is always terminated by an empty line and carries the content-length (0 without body),
+ * so a client on a persistent connection knows where the response ends.
+ * A body which is sent while it is produced (cgi output) is announced as chunked instead.
+ */
 void	Response::create_response(void)
 {
-	_raw_body = _body;
-	// parse the headers from the _raw_body
-	size_t pos = _raw_body.find("\r\n\r\n");
-	if (pos != std::string::npos) {
-		_headers_raw = _raw_body.substr(0, pos);
-		_raw_body = _raw_body.substr(pos + 4);
-	}
-	_response = _protocol + " " + _status_code + " " + _status_text + "\r\n";
+	_head = _protocol + " " + _status_code + " " + _status_text + "\r\n";
 	if (!_redirection.empty())
-		_response += "location: " + _redirection + "\r\n";
-	if (!_content_type.empty() && _headers_raw.find("Content-type") == std::string::npos)
-		_response += "content-type: " + _content_type + "\r\n";
-	if (!_content_length.empty())
-		_response += "content-length: " + to_str(_raw_body.size()) + "\r\n";
+		_head += "location: " + _redirection + "\r\n";
+	if (!_content_type.empty())
+		_head += "content-type: " + _content_type + "\r\n";
+	if (!_transfer_encoding.empty())
+		_head += "transfer-encoding: " + _transfer_encoding + "\r\n";
+	else if (_body_fd != -1) // the body is sent from the file after the head
+		_head += "content-length: " + to_str(_body_file_size) + "\r\n";
+	else if (!_shared_body.empty())
+		_head += "content-length: " + to_str(_shared_body.size()) + "\r\n";
+	else
+		_head += "content-length: " + to_str(_body.size()) + "\r\n";
+	if (!_etag.empty())
+		_head += "etag: " + _etag + "\r\n";
+	if (!_last_modified.empty())
+		_head += "last-modified: " + _last_modified + "\r\n";
+	if (!_connection.empty())
+		_head += "connection: " + _connection + "\r\n";
 	if (!_headers_raw.empty())
-		_response += _headers_raw + "\r\n";
-	_response += "webserver: PETROULETTE\r\n";
-	if (!_body.empty())
-		_response += "\r\n" + _raw_body;
+		_head += _headers_raw + "\r\n";
+	_head += "webserver: PETROULETTE\r\n";
+	_head += "\r\n";
 }
 
 std::string	Response::get_file_format(void)
 {
-	if (_body.find("html") != (unsigned long) -1)
+	if (!_shared_body.empty())
+		return _content_type;
+	if (_body_fd != -1)
+		return sniff_file_format(_body_head);
+	return sniff_file_format(_body);
+}
+
+/**
+ * @brief Guesses the content type by looking for well known markers in the content
+ */
+std::string	Response::sniff_file_format(const std::string &content)
+{
+	if (content.find("html") != (unsigned long) -1)
 		return ("text/html");
-	if (_body.find("PNG") != (unsigned long) -1)
+	if (content.find("PNG") != (unsigned long) -1)
 		return ("image/png");
-	if (_body.find("JFIF") != (unsigned long) -1)
+	if (content.find("JFIF") != (unsigned long) -1)
 		return ("image/jpeg");
-	if (_body.find("GIF") != (unsigned long)-1)
+	if (content.find("GIF") != (unsigned long)-1)
 		return ("image/gif");
-	if (_body.find("MPEG-4") != (unsigned long)-1)
+	if (content.find("MPEG-4") != (unsigned long)-1)
 		return ("video/mp4");
 	return("unknown");
 }
\ No newline at end of file
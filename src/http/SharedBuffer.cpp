@@ -0,0 +1,70 @@
+#include "../../inc/http/SharedBuffer.hpp"
+
+SharedBuffer::SharedBuffer() : _block(NULL)
+{
+}
+
+/**
+ * @brief Takes over the content (swap, no copy), content is empty afterwards.
+ */
+SharedBuffer::SharedBuffer(std::string &content) : _block(new Block)
+{
+	_block->refs = 1;
+	_block->content.swap(content);
+}
+
+SharedBuffer::SharedBuffer(const SharedBuffer &src) : _block(src._block)
+{
+	if (_block)
+		_block->refs++;
+}
+
+SharedBuffer &SharedBuffer::operator=(const SharedBuffer &src)
+{
+	if (_block == src._block)
+		return *this;
+	release();
+	_block = src._block;
+	if (_block)
+		_block->refs++;
+	return *this;
+}
+
+SharedBuffer::~SharedBuffer()
+{
+	release();
+}
+
+/**
+ * @brief Drops the reference, the last one frees the content
+ */
+void	SharedBuffer::release()
+{
+	if (_block && !--_block->refs)
+		delete _block;
+	_block = NULL;
+}
+
+const std::string	&SharedBuffer::str() const
+{
+	static const std::string	empty;
+
+	if (!_block)
+		return empty;
+	return _block->content;
+}
+
+const char	*SharedBuffer::data() const
+{
+	return str().data();
+}
+
+size_t	SharedBuffer::size() const
+{
+	return _block ? _block->content.size() : 0;
+}
+
+bool	SharedBuffer::empty() const
+{
+	return !size();
+}
@@ -0,0 +1,117 @@
+#include "../../inc/http/SpawnBlock.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <spawn.h>
+#include <unistd.h>
+
+SpawnBlock::SpawnBlock() : _arena(sizeof(unsigned int), '\0'), _argc(0)
+{
+}
+
+SpawnBlock::~SpawnBlock()
+{
+}
+
+/**
+ * @brief Appends an argument, all arguments have to be added before the environment
+ */
+void	SpawnBlock::addArgument(const std::string &argument)
+{
+	_arena.append(argument.c_str(), argument.size() + 1);
+	setArgumentCount(_argc + 1);
+}
+
+/**
+ * @brief Appends NAME=value to the environment
+ */
+void	SpawnBlock::addEnvironment(const std::string &name, const std::string &value)
+{
+	_arena.reserve(_arena.size() + name.size() + value.size() + 2);
+	_arena.append(name);
+	_arena += '=';
+	_arena.append(value.c_str(), value.size() + 1);
+}
+
+/**
+ * @brief Takes over an arena which was built by another SpawnBlock (job of a helper)
+ * @return false if data is not a valid arena
+ */
+bool	SpawnBlock::assign(const std::string &data)
+{
+	unsigned int	count;
+	unsigned int	strings = 0;
+
+	if (data.size() < sizeof(count) || (data.size() > sizeof(count) && data[data.size() - 1] != '\0'))
+		return false;
+	std::memcpy(&count, data.data(), sizeof(count));
+	for (size_t i = sizeof(count); i < data.size(); i++)
+		strings += (data[i] == '\0');
+	if (!count || count > strings)
+		return false;
+	_arena = data;
+	_argc = count;
+	_pointers.clear();
+	return true;
+}
+
+const std::string	&SpawnBlock::data() const	{ return _arena; }
+bool				SpawnBlock::empty() const	{ return !_argc; }
+
+void	SpawnBlock::setArgumentCount(unsigned int count)
+{
+	_argc = count;
+	std::memcpy(&_arena[0], &_argc, sizeof(_argc));
+	_pointers.clear();
+}
+
+/**
+ * @brief Starts argv[0] in its own process group with in as stdin and out as stdout.
+ * Both are duplicated onto 0 and 1 in the child, every other filedescriptor of the caller has to be close-on-exec.
+ * SIGPIPE is set back to its default, the worker ignores it and exec would keep that.
+ * @return the pid of the script or -1 (errno is set) if it could not be started or executed
+ */
+pid_t	SpawnBlock::spawn(int in, int out)
+{
+	posix_spawn_file_actions_t	actions;
+	posix_spawnattr_t			attributes;
+	sigset_t					signals;
+	pid_t						pid = -1;
+
+	if (!_argc)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	_pointers.clear();
+	for (size_t offset = sizeof(_argc); offset < _arena.size(); offset = _arena.find('\0', offset) + 1)
+	{
+		if (_pointers.size() == _argc)
+			_pointers.push_back(NULL);
+		_pointers.push_back(&_arena[offset]);
+	}
+	if (_pointers.size() == _argc)
+		_pointers.push_back(NULL);
+	_pointers.push_back(NULL);
+
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, in, STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, out, STDOUT_FILENO);
+	posix_spawnattr_init(&attributes);
+	posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+	posix_spawnattr_setpgroup(&attributes, 0); // own process group, a timeout kills everything the script started
+	sigemptyset(&signals);
+	posix_spawnattr_setsigmask(&attributes, &signals);
+	sigaddset(&signals, SIGPIPE);
+	sigaddset(&signals, SIGCHLD);
+	posix_spawnattr_setsigdefault(&attributes, &signals);
+	int	error = posix_spawn(&pid, _pointers[0], &actions, &attributes, &_pointers[0], &_pointers[_argc + 1]);
+	posix_spawnattr_destroy(&attributes);
+	posix_spawn_file_actions_destroy(&actions);
+	if (error)
+	{
+		errno = error;
+		return -1;
+	}
+	return pid;
+}
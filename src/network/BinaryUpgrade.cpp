@@ -0,0 +1,107 @@
+#include "../../inc/network/BinaryUpgrade.hpp"
+#include "../../inc/network/ServerSocket.hpp"
+#include "../../inc/debugger/DebuggerPrinter.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+BinaryUpgrade::BinaryUpgrade()
+{
+}
+
+BinaryUpgrade::~BinaryUpgrade()
+{
+}
+
+/**
+ * @brief Keeps the arguments of main, the new binary is started with the same ones
+ */
+void	BinaryUpgrade::remember(char **argv)
+{
+	_arguments.clear();
+	for (int i = 0; argv[i]; i++)
+		_arguments.push_back(argv[i]);
+}
+
+/**
+ * @brief Takes over the listening sockets of the binary which started us, once.
+ * Numbers which are not a listening socket are left alone, the variable is removed from the environment.
+ * @return the sockets (close-on-exec again), empty if the server was started normally
+ */
+std::vector<int>	BinaryUpgrade::inheritedSockets()
+{
+	std::vector<int>	fds;
+	const char			*value = std::getenv(LISTEN_FDS_VARIABLE);
+
+	if (!value)
+		return fds;
+	std::string	list(value);
+	unsetenv(LISTEN_FDS_VARIABLE);
+	for (size_t start = 0; start < list.size(); )
+	{
+		size_t		end = list.find(';', start);
+		if (end == std::string::npos)
+			end = list.size();
+		std::string	number = list.substr(start, end - start);
+		char		*rest = NULL;
+		long		fd = std::strtol(number.c_str(), &rest, 10);
+		int			listening = 0;
+		socklen_t	size = sizeof(listening);
+		start = end + 1;
+		if (number.empty() || *rest || fd < 0 || fd > 65535 || std::find(fds.begin(), fds.end(), fd) != fds.end())
+			continue ;
+		if (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &size) < 0 || !listening || !ServerSocket::listeningPort(fd))
+			continue ;
+		fcntl(fd, F_SETFD, FD_CLOEXEC); // a cgi must not inherit the ports
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+		fds.push_back(fd);
+	}
+	return fds;
+}
+
+/**
+ * @brief Starts the new binary on the given listening sockets.
+ * The child closes every other filedescriptor (connections, files, the event loop) before exec,
+ * only the listening sockets lose their close-on-exec flag.
+ * @return the pid of the new binary or -1 if it could not be forked (a failing exec is only logged by the child)
+ */
+pid_t	BinaryUpgrade::start(const std::vector<int> &listening_fds)
+{
+	USE_DEBUGGER;
+	std::string	list;
+
+	if (_arguments.empty())
+		return -1;
+	for (size_t i = 0; i < listening_fds.size(); i++)
+		list += (i ? ";" : "") + to_str(listening_fds[i]);
+	pid_t	pid = fork();
+	if (pid != 0)
+		return pid;
+
+	std::vector<int>	open;
+	DIR					*directory = opendir("/proc/self/fd");
+	if (directory)
+	{
+		for (struct dirent *entry = readdir(directory); entry; entry = readdir(directory))
+			if (entry->d_name[0] != '.')
+				open.push_back(std::atoi(entry->d_name));
+		closedir(directory);
+	}
+	for (size_t i = 0; i < open.size(); i++)
+		if (open[i] > STDERR_FILENO && std::find(listening_fds.begin(), listening_fds.end(), open[i]) == listening_fds.end())
+			close(open[i]);
+	for (size_t i = 0; i < listening_fds.size(); i++)
+		fcntl(listening_fds[i], F_SETFD, 0);
+	setenv(LISTEN_FDS_VARIABLE, list.c_str(), 1);
+
+	std::vector<char *>	argv;
+	for (size_t i = 0; i < _arguments.size(); i++)
+		argv.push_back(&_arguments[i][0]);
+	argv.push_back(NULL);
+	execv(argv[0], &argv[0]);
+	debugger.error("Could not execute " + _arguments[0] + " for the upgrade.");
+	_exit(EXIT_FAILURE);
+}
@@ -0,0 +1,124 @@
+#include "../../inc/network/ChildSupervisor.hpp"
+#include "../../inc/debugger/DebuggerPrinter.hpp"
+#include "../../inc/utility/utility.hpp"
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+int	ChildSupervisor::_pipe[2] = {-1, -1};
+
+ChildSupervisor::ChildSupervisor()
+{
+}
+
+ChildSupervisor::~ChildSupervisor()
+{
+}
+
+/**
+ * @brief Creates the self-pipe and installs the SIGCHLD handler
+ * @return false if the pipe could not be created
+ */
+bool	ChildSupervisor::install()
+{
+	struct sigaction	action;
+
+	if (_pipe[0] >= 0)
+		return true;
+	if (pipe(_pipe) < 0)
+		return false;
+	for (int i = 0; i < 2; i++)
+	{
+		fcntl(_pipe[i], F_SETFL, fcntl(_pipe[i], F_GETFL, 0) | O_NONBLOCK);
+		fcntl(_pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+	action.sa_handler = &ChildSupervisor::notify;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	sigaction(SIGCHLD, &action, NULL);
+	return true;
+}
+
+int	ChildSupervisor::getFd() const	{ return _pipe[0]; }
+
+/**
+ * @brief SIGCHLD handler, only wakes up the event loop.
+ * A full pipe already holds a wake up, the byte may be dropped then.
+ */
+void	ChildSupervisor::notify(int signum)
+{
+	int		saved = errno;
+	char	byte = 0;
+
+	(void) signum;
+	while (write(_pipe[1], &byte, 1) < 0 && errno == EINTR)
+		;
+	errno = saved;
+}
+
+/**
+ * @brief Starts supervising a child which was just forked
+ */
+void	ChildSupervisor::watch(pid_t pid)
+{
+	if (pid > 0)
+		_children[pid] = 0;
+}
+
+/**
+ * @brief Empties the self-pipe and collects every child which exited
+ */
+void	ChildSupervisor::reap()
+{
+	char	buffer[64];
+	pid_t	pid;
+
+	while (read(_pipe[0], buffer, sizeof(buffer)) > 0)
+		;
+	while ((pid = waitpid(-1, NULL, WNOHANG)) > 0)
+		_children.erase(pid);
+}
+
+/**
+ * @brief Kills the child and everything it started right away, it is reaped once SIGCHLD arrived
+ */
+void	ChildSupervisor::terminate(pid_t pid)
+{
+	USE_DEBUGGER;
+	if (_children.find(pid) == _children.end())
+		return ;
+	debugger.verbose("Killing the cgi " + to_str(pid));
+	kill(-pid, SIGKILL);
+	kill(pid, SIGKILL); // in case the child did not get to setpgid yet
+}
+
+/**
+ * @brief The client does not need the child anymore, it has CHILD_EXIT_GRACE seconds left to exit on its own
+ */
+void	ChildSupervisor::release(pid_t pid)
+{
+	std::map<pid_t, std::time_t>::iterator	it = _children.find(pid);
+	if (it != _children.end() && !it->second)
+		it->second = std::time(NULL) + CHILD_EXIT_GRACE;
+}
+
+/**
+ * @brief Kills the released children which are still running after their deadline
+ */
+void	ChildSupervisor::expire(std::time_t now)
+{
+	reap(); // a child might have exited before the handler was installed or while the pipe was full
+	for (std::map<pid_t, std::time_t>::iterator it = _children.begin(); it != _children.end(); ++it)
+		if (it->second && it->second <= now)
+			terminate(it->first);
+}
+
+/**
+ * @brief Returns true while a watched child was not reaped yet
+ */
+bool	ChildSupervisor::hasChildren() const
+{
+	return !_children.empty();
+}
@@ -6,10 +6,10 @@
  * @brief Store all the data related to the client and link it to the forwarded fd
  * Initialize the data we need to track the process for one client to read the request and write the response
  * @param clientSocket, Source information (source port and ip of the client)
- * @param config, Config of the server
+ * @param config, compiled configuration of the server, every request looks up its virtual server in it
  * @param forward, Fd linked to the client (where we will read the request and respond)
  */
-ClientSocket::ClientSocket(struct sockaddr_in clientSocket, ServerBlock &serverBlock, int forward, ConfigFileParsing configFile) : _config(serverBlock), _configFile(configFile)
+ClientSocket::ClientSocket(struct sockaddr_in clientSocket, const ConfigSnapshot &config, int forward) : _timer(this), _config(config)
 {
 	_socket.sin_family = clientSocket.sin_family;
 	_socket.sin_port = clientSocket.sin_port;
@@ -20,33 +20,113 @@ ClientSocket::ClientSocket(struct sockaddr_in clientSocket, ServerBlock &serverB
 	_state = HEADER;
 	_fd = forward;
 	_client_fd = forward;
-	_position = 0;
-	_count = 30000;
 	_event = POLLIN;
 	_remove = false;
-	_timeout = std::time(NULL);
+	_would_block = false;
+	_header_start = TimerWheel::now();
+	_last_progress = _header_start;
 	timestamp = std::time(NULL);
 	_socket_state = PREPARING; // set state of client to PREPARING
+	_keep_alive = false;
+	_draining = false;
+	_keepalive_timeout = _config.routes().defaultServer().keepalive_timeout;
+	_keepalive_requests = _config.routes().defaultServer().keepalive_requests;
+	_header_timeout = _config.routes().defaultServer().client_header_timeout; // the head names the server, until then the default server decides
+	_body_timeout = _config.routes().defaultServer().client_body_timeout;
+	_send_timeout = _config.routes().defaultServer().send_timeout;
+	_requests_served = 0;
+	_parse_error = 0;
+	_body_limit = ULONG_MAX;
+	_cgi_stream = false;
+	_cgi_head_sent = false;
+	_cgi_activity = 0;
 }
 
 ClientSocket::~ClientSocket()
 {
 	USE_DEBUGGER;
+	_process._CGI.finish(true);
 }
 
 /**
- * @brief Check if the client if over the defined timeout
+ * @brief Returns the time (milliseconds, TimerWheel::now) at which the client gave up on what it waits for.
+ * - the head of a request has to arrive within client_header_timeout seconds
+ * - the body may pause for client_body_timeout seconds between two reads
+ * - the client has to take some of the response every send_timeout seconds
+ * - a connection kept open after a response may idle for keepalive_timeout seconds
+ * - a cgi has to produce output every CGI_TIMEOUT seconds
  */
-bool ClientSocket::Timeout()
+unsigned long ClientSocket::deadline() const
 {
-	if (std::time(NULL) - _timeout > 5)
+	if (isWaitingForCgi())
+		return _cgi_activity + CGI_TIMEOUT * 1000UL;
+	if (_func_ptr == &ClientSocket::send_response)
+		return _last_progress + _send_timeout * 1000UL;
+	if (_requests_served && isIdle())
+		return _last_progress + _keepalive_timeout * 1000UL;
+	if (_state == BODY)
+		return _last_progress + _body_timeout * 1000UL;
+	return _header_start + _header_timeout * 1000UL;
+}
+
+/**
+ * @brief The deadline of the client passed.
+ * A client waiting for its cgi gets a 504 (see cgiTimeout), every other client is removed.
+ */
+void ClientSocket::expire()
+{
+	USE_DEBUGGER;
+	if (isWaitingForCgi() && cgiTimeout())
+		return ;
+	debugger.verbose("[TIMEOUT] client did not make progress in time");
+	_socket_state = DONE; // set state of client to DONE because it is finished.
+	_remove = true;
+}
+
+/**
+ * @brief Returns true if the client waits for (the rest of) a request on its socket
+ */
+bool ClientSocket::isWaitingForRequest() const
+{
+	return _func_ptr == &ClientSocket::read_in_buffer;
+}
+
+/**
+ * @brief Returns true if the client waits for its next request and did not receive any byte of it yet
+ */
+bool ClientSocket::isIdle() const
+{
+	return isWaitingForRequest() && _state == HEADER && buffer.empty() && _requests.empty();
+}
+
+/**
+ * @brief Returns true if the client waits for the output of its cgi
+ */
+bool ClientSocket::isWaitingForCgi() const
+{
+	return _func_ptr == &ClientSocket::three || _func_ptr == &ClientSocket::write_fastcgi;
+}
+
+/**
+ * @brief Stops a cgi which did not produce any output for CGI_TIMEOUT seconds.
+ * If nothing was sent yet the client gets a 504, otherwise the connection is closed in the middle of the body.
+ * @return true if the client changed its state (it wants to be removed or sends the error now)
+ */
+bool ClientSocket::cgiTimeout()
+{
+	USE_DEBUGGER;
+	debugger.verbose("[TIMEOUT] cgi did not answer in time");
+	_process._CGI.finish(true);
+	if (_cgi_head_sent)
 	{
-		USE_DEBUGGER;
 		_socket_state = DONE; // set state of client to DONE because it is finished.
 		_remove = true;
 		return true;
 	}
-	return false;
+	_cgi_output.clear();
+	_process.exception(504);
+	queue_response();
+	return true;
 }
 
 /**
@@ -58,70 +138,230 @@ void	ClientSocket::call_func_ptr(void)
 }
 
 /**
- * @brief reads the requst from the clientSocket until \r\n\r\n.
- * If a Body is appended change the _state = BODY and reads until it reaches content_lenght as it is defined in the header.
- * After parsing the request it will call the setup function to set up the response, either after building header and not seeing any body or after building the body.
+ * @brief reads from the clientSocket and queues every complete request found in the buffer.
+ * A pipelining client can send several requests back to back, so one read may contain more than one of them.
+ * As soon as at least one request is complete, the queued requests are being served.
  */
 void	ClientSocket::read_in_buffer(void)
 {
-	USE_DEBUGGER;
-	buffer.resize(buffer.size() + _count);
-	_bytes = read(_fd, (char*)buffer.c_str() + _position, _count);
+	bool	idle = _requests_served && isIdle();
+
+	_bytes = buffer.readFrom(_fd);
+	if (_bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { // everything available was read, wait for the next event
+		_would_block = true;
+		return;
+	}
 	if (_bytes <= 0){
 		_remove = true;
 		return;
 	}
-	_position += _bytes;
-	if (_state == HEADER)
+	_last_progress = TimerWheel::now();
+	if (idle) // the next request of a persistent connection starts
+		_header_start = _last_progress;
+	if (!parse_requests())
+		return ;
+	serve_queued_requests();
+	return ;
+}
+
+/**
+ * @brief Moves all complete requests at the beginning of the buffer into the request queue.
+ * The parser continues where it stopped on the last read, so a head arriving in pieces is only scanned once.
+ * If a body is announced (content-length or chunked) its bytes are handed to the request as they arrive,
+ * the request is complete once the whole body arrived. The post_max_size of the server block
+ * is checked before the body is read, a bigger body is rejected with 413.
+ * Everything behind the body belongs to the next request and stays in the buffer.
+ * An invalid head stops the parsing, it is answered once the requests in front of it are served.
+ * @return false if a request body was invalid, the client will be removed then.
+ */
+bool	ClientSocket::parse_requests(void)
+{
+	USE_DEBUGGER;
+	while (!_parse_error && _requests.size() < MAXIMUM_PIPELINED_REQUESTS)
 	{
-		size_t pos = buffer.find("\r\n\r\n");
-		if (pos != std::string::npos)
+		if (_state == HEADER)
 		{
-			std::string httpRequestHead = buffer.substr(0, pos + 3);
-			// if parsing the request failed, we tell the client it should remove the connection
+			ParseStatus status = _parser.parse(buffer.data(), buffer.size());
+			if (status == PARSE_NEED_MORE)
+				return true;
+			_pendingRequest = Request();
 			try {
-				_clientRequest.parser(httpRequestHead);
-			} catch (...) {
-				debugger.error("INVALID REQUEST. Will be removed!");
-				_remove = true;
-				_socket_state = DONE; // set state of client to DONE because it is finished.
-				return ;
+				if (status == PARSE_ERROR)
+					throw (_parser.getError());
+				_pendingRequest.parse(buffer.data(), _parser);
+			} catch (int e) {
+				debugger.error("INVALID REQUEST. Will be rejected!");
+				reject(e, _config.routes().defaultServer());
+				return true;
 			}
-			buffer.erase(0, pos + 3);
-			_position -= pos + 3;
+			buffer.consume(_parser.getHeadSize());
+			_parser.reset();
 			_state = BODY;
-			_content_length = atoi(_clientRequest.findHeader("Content-Length").c_str());
-			if (!_content_length)
+			_content_length = _pendingRequest.getContentLength();
+			_body_limit = ULONG_MAX;
+			_chunked.reset();
+			if (_content_length || _pendingRequest.isChunked())
 			{
-				set_up();
-				return ;
+				const VirtualServer &server = getServer(_pendingRequest);
+				_body_limit = server.post_max_size;
+				_body_timeout = server.client_body_timeout;
+				if (_content_length > _body_limit)
+				{
+					debugger.error("REQUEST BODY TOO BIG. Will be rejected!");
+					reject(413, server);
+					return true;
+				}
 			}
 		}
+		// after we read the header we read the body
+		if (!read_body())
+			return !_remove;
+		_requests.push_back(_pendingRequest);
+		_state = HEADER;
 	}
-	// after we read the header we read the body
-	if (_state == BODY)
+	return true;
+}
+
+/**
+ * @brief Hands the body bytes at the beginning of the buffer to the pending request.
+ * With a content-length _content_length counts the bytes still missing,
+ * a chunked body is decoded as it arrives until the last chunk was read.
+ * @return true once the whole body arrived
+ */
+bool	ClientSocket::read_body(void)
+{
+	size_t	skip;
+	size_t	size;
+
+	if (!_pendingRequest.isChunked())
 	{
-		if (_position >= _content_length)
+		if (_content_length && !buffer.empty())
 		{
-			try {
-				_clientRequest.setBody(buffer);
-			} catch (...){
-				debugger.error("INVALID REQUEST BODY. Will be removed!");
-				_socket_state = DONE; // set state of client to DONE because it is finished.
-				_remove = true;
-				return ;
-			}
-			set_up();
-			return ;
+			size = std::min((size_t)_content_length, buffer.size());
+			if (!append_body(buffer.data(), size))
+				return false;
+			buffer.consume(size);
+			_content_length -= size;
 		}
+		return !_content_length;
 	}
-	return ;
+	while (!buffer.empty())
+	{
+		ChunkStatus status = _chunked.decode(buffer.data(), buffer.size(), skip, size);
+		if (status == CHUNK_ERROR)
+		{
+			reject(_chunked.getError(), getServer(_pendingRequest));
+			return false;
+		}
+		if (size && !append_body(buffer.data() + skip, size))
+			return false;
+		buffer.consume(skip + size);
+		if (status == CHUNK_DONE)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Appends body bytes to the pending request, the running size is checked against post_max_size.
+ * @return false if the request was rejected or the client will be removed
+ */
+bool	ClientSocket::append_body(const char *data, size_t size)
+{
+	USE_DEBUGGER;
+	if (_pendingRequest.getBodySize() + size > _body_limit)
+	{
+		debugger.error("REQUEST BODY TOO BIG. Will be rejected!");
+		reject(413, getServer(_pendingRequest));
+		return false;
+	}
+	try {
+		_pendingRequest.appendBody(data, size);
+	} catch (...){
+		debugger.error("INVALID REQUEST BODY. Will be removed!");
+		_socket_state = DONE; // set state of client to DONE because it is finished.
+		_remove = true;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Serves the queued requests in the order they arrived.
+ * The responses of consecutive static requests are collected in _output and sent together.
+ * A cgi request interrupts the batch, its response is queued once the cgi is done.
+ */
+void	ClientSocket::serve_queued_requests(void)
+{
+	while (!_requests.empty() && _output.size() < PIPELINE_OUTPUT_LIMIT)
+	{
+		_clientRequest = _requests.front();
+		_requests.pop_front();
+		set_up();
+		if (_remove || _process._with_cgi || !_keep_alive)
+			return ;
+	}
+	if (_requests.empty() && _parse_error)
+		reject_request();
+}
+
+/**
+ * @brief Stops parsing, the request is answered with the error of server once the requests in front of it are served.
+ * An invalid head is answered by the default server, the request line could not be trusted.
+ */
+void	ClientSocket::reject(int status, const VirtualServer &server)
+{
+	_parse_error = status;
+	_rejection = server.block.getErrorResponse(status, false);
+}
+
+/**
+ * @brief Answers the rejected request and closes the connection afterwards,
+ * we can not know where the next request would start.
+ */
+void	ClientSocket::reject_request(void)
+{
+	_parse_error = 0;
+	_keep_alive = false;
+	_process = Process();
+	_process._response.set_prerendered(_rejection);
+	_rejection = SharedBuffer();
+	queue_response();
+}
+
+/**
+ * @brief Appends the response of the current request to the output and switches to sending.
+ */
+void	ClientSocket::queue_response(void)
+{
+	Response	&response = _process._response;
+	size_t		file_size = response.get_body_file_size();
+
+	_output.pushData(response.get_head());
+	_output.pushData(response.get_payload());
+	_output.pushShared(response.get_shared_body());
+	if (response.has_body_file())
+		_output.pushFile(response.release_body_file(), 0, file_size);
+	_requests_served++;
+	start_sending();
+}
+
+/**
+ * @brief Switches to sending _output to the client.
+ */
+void	ClientSocket::start_sending(void)
+{
+	_fd = _client_fd;
+	_func_ptr = &ClientSocket::send_response;
+	_socket_state = SENDING_RESPONSE;
+	_event = POLLOUT;
+	_last_progress = TimerWheel::now();
 }
 
 /**
- * @brief writes the response to the clientSocket
+ * @brief writes the queued responses to the clientSocket
  * We need to check if the bytes are actually zero before we write to the clientSocket.
- * _position keeps track of what the client already received.
+ * Every call sends the next piece of _output (head or body in memory, or a file region with sendfile).
  */
 void	ClientSocket::send_response(void)
 {
@@ -139,9 +379,12 @@ void	ClientSocket::send_response(void)
 		close(_fd);
 		return ;
 	}
-	_bytes = send(_fd, _process._response.get_response().data() + _position, _process._response.get_response().length() - _position, 0);
-	// content to be sent:
-	//std::cout << "FOR IMAGE " << _clientRequest.getScript().first << _process._response.get_response().data() + _position << std::endl;
+	_bytes = _output.sendTo(_fd);
+	if (_bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) // socket buffer is full, wait for the next event
+	{
+		_would_block = true;
+		return ;
+	}
 	if (_bytes < 1 )
 	{
 		_remove = true;
@@ -149,39 +392,131 @@ void	ClientSocket::send_response(void)
 		debugger.verbose("Error while sending response to client");
 		return ;
 	}
-	_position += _bytes;
-	if (_position >= _process._response.get_response().length())
+	_last_progress = TimerWheel::now();
+	if (_output.empty() && _process._CGI._fd_out >= 0) // the cgi is still running, wait for its next output
+	{
+		_fd = _process._CGI._fd_out;
+		_func_ptr = &ClientSocket::three;
+		_socket_state = READING_CGI;
+		_event = POLLIN;
+		_cgi_activity = TimerWheel::now();
+		return ;
+	}
+	if (_output.empty())
 	{
 		debugger.debug("Completed sending (chunked) response to client");
+		finish_response();
+		return ;
+	}
+	return ;
+}
+
+/**
+ * @brief Decides if the connection stays open after the response to the current request.
+ * HTTP/1.1 connections are persistent unless the client sends "Connection: close",
+ * HTTP/1.0 connections only if the client asks for it with "Connection: keep-alive".
+ * The limits of the server block serving the request apply (keepalive_timeout 0 disables keep-alive).
+ */
+bool	ClientSocket::wants_keep_alive(const VirtualServer &server)
+{
+	_keepalive_timeout = server.keepalive_timeout;
+	_keepalive_requests = server.keepalive_requests;
+	if (_draining || !_keepalive_timeout || _requests_served + 1 >= _keepalive_requests)
+		return false;
+	std::string connection = lower_str_ret(_clientRequest.findHeader(Connection));
+	if (connection.find("close") != std::string::npos)
+		return false;
+	if (_clientRequest.getHttpversion().first.find("HTTP/1.0") == 0)
+		return connection.find("keep-alive") != std::string::npos;
+	return true;
+}
+
+/**
+ * @brief Called once the whole output was sent.
+ * Either the connection gets closed, the next pipelined request is served or the client waits for the next request.
+ */
+void	ClientSocket::finish_response(void)
+{
+	if (!_keep_alive)
+	{
 		_socket_state = DONE; // set state of client to DONE because it is finished.
 		_remove = true;
 		return ;
 	}
-	return ;
+	reset();
+	if (!parse_requests())
+		return ;
+	serve_queued_requests();
+}
+
+/**
+ * @brief Resets the client to read the next request.
+ * Bytes of pipelined requests which are already in the buffer or the queue are kept.
+ */
+void	ClientSocket::reset(void)
+{
+	_process._CGI.finish(true);
+	_clientRequest = Request();
+	_process = Process();
+	if (!_next_config.empty())
+	{
+		_config = _next_config;
+		_next_config = ConfigSnapshot();
+	}
+	_bytes = 0;
+	_func_ptr = &ClientSocket::read_in_buffer;
+	_fd = _client_fd;
+	_event = POLLIN;
+	_header_start = TimerWheel::now();
+	_last_progress = _header_start;
+	_socket_state = PREPARING;
+}
+
+/**
+ * @brief Serves the next requests with a reloaded configuration.
+ * A client waiting for a request switches right away, otherwise the request it is busy with
+ * is finished on the configuration it started with.
+ */
+void	ClientSocket::reconfigure(const ConfigSnapshot &config)
+{
+	if (isWaitingForRequest())
+		_config = config;
+	else
+		_next_config = config;
+}
+
+/**
+ * @brief The server stops: the current response is the last one, the connection is closed once it was sent.
+ * Its head may still announce keep-alive, a client has to expect the close anyway.
+ */
+void	ClientSocket::drain(void)
+{
+	_draining = true;
+	_keep_alive = false;
 }
 
 /**
- * @brief Returns the fitting server block for the client request which was parsed in the read_in_buffer function
+ * @brief Returns the fitting virtual server for the client request which was parsed in the read_in_buffer function
  * 
- * @return ServerBlock 
+ * @return const VirtualServer& 
  */
-ServerBlock ClientSocket::getServerBlock()
+const VirtualServer &ClientSocket::getServer(Request &request)
 {
 	USE_DEBUGGER;
-	std::string host = _clientRequest.findHeader("Host");
+	std::string host = request.findHeader("Host");
 	// get port from host
 	std::string portString = host.substr(host.find(":") + 1);
 	unsigned int port = 80;
 	if (portString != "")
 		port = atoi(portString.c_str());
 	if (host.empty())
-		host = _clientRequest.getHost();
+		host = request.getHost();
 	// remove the port from the host header and cut everything after it like path
 	size_t pos = host.find(":");
 	if (pos != std::string::npos)
 		host = host.substr(0, pos);
 	host = trim_whitespaces(host);
-	return _configFile.getServerBlockWithServerNameAndServerPort(host, port);
+	return _config.routes().resolve(host, port);
 }
 
 /**
@@ -194,7 +529,11 @@ void	ClientSocket::set_up(void)
 	// TODO: IMPORTANT: we need to check if the server block is valid and if not, we need to send a 404. We cannot()! send a 404 if the construction of the Process fails. Fix this ASAP
 	try
 	{
-		_process = Process(_clientRequest, getServerBlock());
+		const VirtualServer &server = getServer(_clientRequest);
+		_keep_alive = wants_keep_alive(server);
+		_send_timeout = server.send_timeout;
+		_process = Process(_clientRequest, server);
+		_process._response.set_connection(_keep_alive ? "keep-alive" : "close");
 		_process.process_request();
 	}
 	catch (int e)
@@ -207,87 +546,199 @@ void	ClientSocket::set_up(void)
 	if (_process._with_cgi) // in the next step we will write in the cgi input
 	{
 		_bytes = 0;
-		_position = 0;
-		_func_ptr = &ClientSocket::one;
-		_fd = _process._CGI._fd_in;
-		_event = POLLOUT;
+		_cgi_stream = _clientRequest.getHttpversion().first == "HTTP/1.1"; // HTTP/1.0 does not know chunked
+		_cgi_head_sent = false;
+		_cgi_output.clear();
+		_cgi_activity = TimerWheel::now();
+		if (_process._CGI.isFastCgi()) // the request goes to the FastCGI server, there is no input file
+		{
+			if (_process._CGI._fd_out < 0) // not connected to the FastCGI server, answer with a 502 instead of waiting on nothing
+			{
+				_process._with_cgi = false;
+				_process.exception(502);
+				queue_response();
+				return ;
+			}
+			_func_ptr = &ClientSocket::write_fastcgi;
+			_fd = _process._CGI._fd_out;
+			_socket_state = WRITING_CGI;
+			_event = POLLOUT;
+			return ;
+		}
+		two(); // the stdin of the cgi is ready, the script can start
 	}
 	else  // in the next step we will send the response to the client as soon as it is ready
 	{
 		_bytes = 0;
-		_position = 0;
-		_func_ptr = &ClientSocket::send_response;
-		_socket_state = SENDING_RESPONSE; // set state of client to DONE because it is finished.
-		_event = POLLOUT;
+		queue_response();
 	}
 	return ;
 }
 
 /**
- * @brief writes in the std in of the cgi.
- */
-void	ClientSocket::one(void)
+ * Runs the cgi once its stdin is prepared and waits for its output
+ * A script which can not be executed gets a 502.
+*/
+void	ClientSocket::two(void)
 {
 	USE_DEBUGGER;
 	try {
-		_process._CGI.write_in_std_in();
-	} catch (int e) {
+		_process._CGI.execute_cgi();
+	} catch (int error) {
+		debugger.verbose("Thrown cgi exception in ::two");
+		if (error == 502) // the script could not be executed
+		{
+			_process._CGI.finish(true);
+			_process.exception(502);
+			queue_response();
+			return ;
+		}
+		std::cerr << "Error in ::two " << error << std::endl;
 		_event = POLLERR;
-		debugger.verbose("Thrown exception in ::one");
-		_process.exception(e);
 		_remove = true;
+		_process.server_overloaded();
 		return ;
 	}
 	_fd = _process._CGI._fd_out;
-	_event = POLLOUT;
-	_func_ptr = &ClientSocket::two;
+	_event = POLLIN;
+	_func_ptr = &ClientSocket::three;
+	_socket_state = READING_CGI;
+	_cgi_activity = TimerWheel::now();
 	return ;
 }
 
 /**
- * If writing in the stdin of the cgi is completed, we run it
+ * Sends the request to the FastCGI server, then waits for its answer like for the output of a cgi.
+ * If the server can not be reached the client gets a 502.
 */
-void	ClientSocket::two(void)
+void	ClientSocket::write_fastcgi(void)
 {
 	USE_DEBUGGER;
-	try {
-		_process._CGI.execute_cgi();
-	} catch (int error) {
-		debugger.verbose("Thrown cgi exception in ::two");
-		std::cerr << "Error in ::two " << error << std::endl;
-		_event = POLLERR;
-		_remove = true;
-		_process.server_overloaded();
+	int	result = _process._CGI.send_fastcgi();
+
+	if (result == 0)
+	{
+		_would_block = true;
+		return ;
+	}
+	if (result < 0)
+	{
+		debugger.verbose("Could not send the request to the FastCGI server");
+		_process._CGI.finish(true);
+		_process.exception(502);
+		queue_response();
 		return ;
 	}
-	_fd = _process._CGI._fd_out;
 	_event = POLLIN;
 	_func_ptr = &ClientSocket::three;
-	return ;
+	_socket_state = READING_CGI;
 }
 
 /**
- * After running the cgi, we send the response to the client.
+ * Relays the output of the cgi to the client while the script runs.
+ * The pipe is read until it would block (or CGI_OUTPUT_LIMIT bytes were read), then the output is sent
+ * and we come back to the pipe once it is out. A slow client therefore slows down the script instead of filling our memory.
 */
 void	ClientSocket::three(void)
 {
 	USE_DEBUGGER;
-	try {
-		_process._CGI.read_in_buff();
-	} catch (int error) {
-		debugger.verbose("Thrown cgi exception in ::three");
-		_event = POLLERR;
-		_remove = true;
-		_process.server_overloaded();
+	size_t	received = 0;
+
+	while (received < CGI_OUTPUT_LIMIT)
+	{
+		_bytes = _process._CGI.read_output(_cgi_output);
+		if (_bytes > 0)
+		{
+			received += _bytes;
+			continue ;
+		}
+		if (_bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			if (received)
+				_cgi_activity = TimerWheel::now();
+			relay_cgi_output(false);
+			if (_output.empty() && _func_ptr == &ClientSocket::three)
+				_would_block = true;
+			else if (_func_ptr == &ClientSocket::three)
+				start_sending();
+			return ;
+		}
+		if (_bytes < 0) // the script closed its output
+			debugger.verbose("Error while reading the cgi output");
+		_process._CGI.finish(false);
+		relay_cgi_output(true);
+		if (_func_ptr == &ClientSocket::three)
+			start_sending();
 		return ;
 	}
-	if (_process._with_cgi)
+	_cgi_activity = TimerWheel::now(); // more output is waiting, we get called again
+	if (_cgi_stream)
 	{
-		_process.build_cgi_response();
+		relay_cgi_output(false);
+		if (!_output.empty() && _func_ptr == &ClientSocket::three)
+			start_sending();
 	}
-	_fd = _client_fd;
-	_event = POLLOUT;
-	_func_ptr = &ClientSocket::send_response;
+}
 
-	return ;
-}
\ No newline at end of file
+/**
+ * @brief Moves the collected cgi output to _output.
+ * The head is built once the header fields of the script are complete. While the script runs the body is
+ * sent with Transfer-Encoding: chunked, a script which finished before (or a HTTP/1.0 client) gets a content-length.
+ * @param eof the script closed its output, everything it printed is in _cgi_output
+ */
+void	ClientSocket::relay_cgi_output(bool eof)
+{
+	if (!_cgi_head_sent)
+	{
+		if (!eof && !_cgi_stream)
+			return ;
+		size_t	end = _cgi_output.find("\r\n\r\n");
+		size_t	skip = 4;
+		if (_cgi_output.find("\n\n") < end)
+		{
+			end = _cgi_output.find("\n\n");
+			skip = 2;
+		}
+		if (end == std::string::npos)
+		{
+			if (!eof && _cgi_output.size() < CGI_HEADER_MAXIMUM_SIZE)
+				return ;
+			if (!eof || _cgi_output.empty()) // no output at all or endless header fields
+			{
+				_process._CGI.finish(true);
+				_cgi_output.clear();
+				_process.exception(502);
+				queue_response();
+				return ;
+			}
+			end = 0; // no header fields, everything is the body
+			skip = 0;
+		}
+		std::string headers = _cgi_output.substr(0, end);
+		_cgi_output.erase(0, end + skip);
+		_cgi_head_sent = true;
+		if (eof)
+		{
+			_process.build_cgi_response(headers, _cgi_output, false);
+			_cgi_output.clear();
+			queue_response();
+			return ;
+		}
+		_process.build_cgi_response(headers, _cgi_output, true);
+		_output.pushData(_process._response.get_head());
+		_requests_served++;
+	}
+	if (!_cgi_output.empty())
+	{
+		std::string	size = inttohex(_cgi_output.size()) + "\r\n";
+		std::string	end = "\r\n";
+		_output.pushData(size);
+		_output.pushData(_cgi_output);
+		_output.pushData(end);
+	}
+	if (eof)
+	{
+		std::string	last = "0\r\n\r\n";
+		_output.pushData(last);
+	}
+}
@@ -0,0 +1,96 @@
+#include "../../inc/network/ControlSignals.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+int						ControlSignals::_pipe[2] = {-1, -1};
+volatile sig_atomic_t	ControlSignals::_received[NSIG];
+
+ControlSignals::ControlSignals()
+{
+}
+
+ControlSignals::~ControlSignals()
+{
+}
+
+/**
+ * @brief Creates the self-pipe (closes the one inherited from the parent) and installs the handlers
+ * @return false if the pipe could not be created
+ */
+bool	ControlSignals::install()
+{
+	struct sigaction	action;
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (_pipe[i] >= 0)
+			close(_pipe[i]);
+		_pipe[i] = -1;
+	}
+	if (pipe(_pipe) < 0)
+		return false;
+	for (int i = 0; i < 2; i++)
+	{
+		fcntl(_pipe[i], F_SETFL, fcntl(_pipe[i], F_GETFL, 0) | O_NONBLOCK);
+		fcntl(_pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+	action.sa_handler = &ControlSignals::notify;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = 0;
+	sigaction(SIGHUP, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	sigaction(SIGQUIT, &action, NULL);
+	sigaction(SIGUSR2, &action, NULL);
+	return true;
+}
+
+/**
+ * @brief Restores the default handlers and closes the self-pipe inherited from the parent,
+ * a signal sent to the process group stops the process again instead of waking up the parent
+ */
+void	ControlSignals::uninstall()
+{
+	signal(SIGHUP, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	signal(SIGQUIT, SIG_DFL);
+	signal(SIGUSR2, SIG_DFL);
+	for (int i = 0; i < 2; i++)
+	{
+		if (_pipe[i] >= 0)
+			close(_pipe[i]);
+		_pipe[i] = -1;
+	}
+}
+
+int	ControlSignals::getFd() const	{ return _pipe[0]; }
+
+/**
+ * @brief Returns true once for a signal received since the last call, empties the self-pipe
+ */
+bool	ControlSignals::received(int signum)
+{
+	char	buffer[64];
+
+	while (_pipe[0] >= 0 && read(_pipe[0], buffer, sizeof(buffer)) > 0)
+		;
+	if (!_received[signum])
+		return false;
+	_received[signum] = 0;
+	return true;
+}
+
+/**
+ * @brief Signal handler, marks the signal and wakes up the event loop.
+ * A full pipe already holds a wake up, the byte may be dropped then.
+ */
+void	ControlSignals::notify(int signum)
+{
+	int		saved = errno;
+	char	byte = 0;
+
+	_received[signum] = 1;
+	while (_pipe[1] >= 0 && write(_pipe[1], &byte, 1) < 0 && errno == EINTR)
+		;
+	errno = saved;
+}
@@ -0,0 +1,164 @@
+#include "../../inc/network/EpollEventLoop.hpp"
+
+#ifdef __linux__
+
+# include <unistd.h>
+# include <cerrno>
+# include <cstring>
+
+EpollEventLoop::EpollEventLoop() : _events(EPOLL_MAX_EVENTS)
+{
+	_epfd = epoll_create(EPOLL_MAX_EVENTS);
+	if (_epfd < 0)
+		throw EpollCreationError();
+}
+
+EpollEventLoop::~EpollEventLoop()
+{
+	close(_epfd);
+}
+
+/**
+ * @brief Translates poll flags to epoll flags. Every registration is edge triggered.
+ */
+unsigned int	EpollEventLoop::toEpollEvents(short events)
+{
+	unsigned int	result = EPOLLET;
+	if (events & POLLIN)
+		result |= EPOLLIN;
+	if (events & POLLOUT)
+		result |= EPOLLOUT;
+	return result;
+}
+
+/**
+ * @brief Translates the epoll flags reported by the kernel back to poll flags.
+ */
+short	EpollEventLoop::toPollEvents(unsigned int events)
+{
+	short	result = 0;
+	if (events & EPOLLIN)
+		result |= POLLIN;
+	if (events & EPOLLOUT)
+		result |= POLLOUT;
+	if (events & EPOLLERR)
+		result |= POLLERR;
+	if (events & EPOLLHUP)
+		result |= POLLHUP;
+	return result;
+}
+
+/**
+ * @brief Returns the registered events of fd or NOT_WATCHED
+ */
+short	EpollEventLoop::getInterest(int fd) const
+{
+	if (fd < 0 || (size_t) fd >= _interests.size())
+		return NOT_WATCHED;
+	return _interests[fd];
+}
+
+/**
+ * @brief Registers fd in the epoll instance.
+ * Regular files are refused by epoll with EPERM, those are put in the always ready list instead.
+ */
+bool	EpollEventLoop::add(int fd, short events)
+{
+	if (fd < 0)
+		return false;
+	if (getInterest(fd) != NOT_WATCHED || _always_ready.count(fd))
+		return modify(fd, events);
+	struct epoll_event	ev;
+	std::memset(&ev, 0, sizeof(ev));
+	ev.events = toEpollEvents(events);
+	ev.data.fd = fd;
+	if (epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev) == 0)
+	{
+		if ((size_t) fd >= _interests.size())
+			_interests.resize(fd + 1, NOT_WATCHED);
+		_interests[fd] = events;
+		return true;
+	}
+	if (errno == EPERM)
+	{
+		_always_ready[fd] = events;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Changes the events we are waiting for. Re-arming an edge triggered fd with EPOLL_CTL_MOD
+ * makes the kernel report it again if it is already ready, so switching from reading to writing never misses an event.
+ */
+bool	EpollEventLoop::modify(int fd, short events)
+{
+	std::map<int, short>::iterator	it = _always_ready.find(fd);
+	if (it != _always_ready.end())
+	{
+		(*it).second = events;
+		return true;
+	}
+	short	current = getInterest(fd);
+	if (current == NOT_WATCHED)
+		return add(fd, events);
+	if (current == events)
+		return true;
+	struct epoll_event	ev;
+	std::memset(&ev, 0, sizeof(ev));
+	ev.events = toEpollEvents(events);
+	ev.data.fd = fd;
+	if (epoll_ctl(_epfd, EPOLL_CTL_MOD, fd, &ev) != 0)
+		return false;
+	_interests[fd] = events;
+	return true;
+}
+
+/**
+ * @brief Unregisters fd. Has to be called before the fd gets closed, a closed fd can't be removed anymore.
+ */
+void	EpollEventLoop::remove(int fd)
+{
+	if (_always_ready.erase(fd))
+		return ;
+	if (getInterest(fd) == NOT_WATCHED)
+		return ;
+	_interests[fd] = NOT_WATCHED;
+	epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+/**
+ * @brief Waits for ready filedescriptors. If regular files are registered we do not block at all,
+ * because they are ready anyway.
+ * @return the number of ready filedescriptors, -1 on error
+ */
+int	EpollEventLoop::wait(std::vector<IoEvent> &ready, int timeout)
+{
+	ready.clear();
+	if (!_always_ready.empty())
+		timeout = 0;
+	int	count = epoll_wait(_epfd, _events.data(), _events.size(), timeout);
+	if (count < 0)
+		return count;
+	for (int i = 0; i < count; ++i)
+	{
+		IoEvent	event;
+		event.fd = _events[i].data.fd;
+		event.events = toPollEvents(_events[i].events);
+		ready.push_back(event);
+	}
+	for (std::map<int, short>::iterator it = _always_ready.begin(); it != _always_ready.end(); ++it)
+	{
+		IoEvent	event;
+		event.fd = (*it).first;
+		event.events = (*it).second & (POLLIN | POLLOUT);
+		ready.push_back(event);
+	}
+	return ready.size();
+}
+
+bool	EpollEventLoop::isEdgeTriggered() const { return true; }
+
+const char	*EpollEventLoop::getName() const { return "epoll"; }
+
+#endif
@@ -0,0 +1,27 @@
+#include "../../inc/network/EventLoop.hpp"
+#include "../../inc/network/PollEventLoop.hpp"
+#include "../../inc/network/EpollEventLoop.hpp"
+#include "../../inc/debugger/DebuggerPrinter.hpp"
+
+/**
+ * @brief Returns the best event loop backend available.
+ * - epoll on linux (edge triggered), unless the build defines WEBSERV_USE_POLL
+ * - poll everywhere else or if the epoll instance couldn't be created
+ * The caller owns the returned object.
+ */
+EventLoop *EventLoop::create()
+{
+	USE_DEBUGGER;
+#if defined(__linux__) && !defined(WEBSERV_USE_POLL)
+	try {
+		EventLoop *loop = new EpollEventLoop();
+		debugger.info("Using epoll event loop.");
+		return loop;
+	} catch (const std::exception &e) {
+		debugger.warning(e.what());
+		debugger.warning("Falling back to poll event loop.");
+	}
+#endif
+	debugger.info("Using poll event loop.");
+	return new PollEventLoop();
+}
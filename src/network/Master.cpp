@@ -0,0 +1,227 @@
+#include "../../inc/network/Master.hpp"
+#include "../../inc/network/ServerSocket.hpp"
+#include "../../inc/network/ControlSignals.hpp"
+#include "../../inc/network/BinaryUpgrade.hpp"
+#include "../../inc/debugger/DebuggerPrinter.hpp"
+#include <sys/wait.h>
+#include <cstdlib>
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>
+
+/**
+ * @brief Opens the listening sockets of every worker. Nothing is forked yet.
+ * After a binary upgrade the sockets of the previous binary are dealt to the workers in turn,
+ * a worker only gets new sockets for the ports it got none of.
+ * @param config the compiled configuration, the workers get a copy of it with fork
+ * @param address network interface where to listen
+ * @param workers amount of worker processes
+ * @throws ServerSocket::SocketCreationError
+ */
+Master::Master(const ConfigSnapshot &config, unsigned int address, int workers) : _config(config), _address(address), _stopping(false)
+{
+	std::vector<int>	inherited = BinaryUpgrade::getInstance().inheritedSockets();
+	const std::vector<unsigned int>	&ports = _config.ports();
+	std::vector<int>	dealt(ports.size(), 0); // inherited sockets per port handed out so far
+
+	_listeners.resize(workers);
+	for (size_t i = 0; i < inherited.size(); i++)
+	{
+		size_t	port = std::find(ports.begin(), ports.end(), ServerSocket::listeningPort(inherited[i])) - ports.begin();
+		if (port == ports.size())
+			close(inherited[i]);
+		else
+			_listeners[dealt[port]++ % workers].push_back(inherited[i]);
+	}
+	for (int i = 0; i < workers; i++)
+	{
+		std::vector<int>	opened = ServerSocket::openListeningSockets(ServerSocket::missingPorts(ports, _listeners[i]), address, true);
+		_listeners[i].insert(_listeners[i].end(), opened.begin(), opened.end());
+	}
+	_pids.resize(workers, -1);
+	_started.resize(workers, 0);
+}
+
+Master::~Master()
+{
+	for (size_t i = 0; i < _listeners.size(); i++)
+		for (size_t j = 0; j < _listeners[i].size(); j++)
+			close(_listeners[i][j]);
+}
+
+/**
+ * @brief Forks the worker of the given slot.
+ * The worker closes the sockets of all other workers and serves on its own ones until it dies.
+ */
+void	Master::spawnWorker(int slot)
+{
+	USE_DEBUGGER;
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		debugger.error("Could not fork worker " + to_str(slot));
+		return ;
+	}
+	if (pid == 0) // worker
+	{
+		for (size_t i = 0; i < _listeners.size(); i++)
+			if ((int) i != slot)
+				for (size_t j = 0; j < _listeners[i].size(); j++)
+					close(_listeners[i][j]);
+		try {
+			ServerSocket server(_config, _address, _listeners[slot]);
+		} catch (...) {
+			debugger.error("Worker " + to_str(slot) + " stopped because of an error.");
+			std::exit(EXIT_FAILURE);
+		}
+		std::exit(EXIT_SUCCESS); // stopped by SIGTERM or SIGQUIT
+	}
+	_pids[slot] = pid;
+	_started[slot] = std::time(NULL);
+	debugger.info("Started worker " + to_str(slot) + " with pid " + to_str(pid));
+}
+
+/**
+ * @brief Returns the slot of the worker with the given pid or -1
+ */
+int	Master::findWorker(pid_t pid)
+{
+	for (size_t i = 0; i < _pids.size(); i++)
+		if (_pids[i] == pid)
+			return i;
+	return -1;
+}
+
+/**
+ * @brief Checks the configuration file (SIGHUP) and lets the workers reload it.
+ * Workers started afterwards get the new configuration. An invalid file is not forwarded.
+ */
+void	Master::reload()
+{
+	USE_DEBUGGER;
+	ConfigSnapshot	config;
+
+	try {
+		config = ConfigSnapshot::load(_config.path());
+	} catch (const std::exception &e) {
+		debugger.error("Could not reload " + _config.path() + ", keeping the current configuration: " + e.what());
+		return ;
+	}
+	_config = config;
+	const std::vector<unsigned int>	&ports = _config.ports();
+	for (size_t i = 0; i < _listeners.size(); i++)
+	{
+		for (size_t j = _listeners[i].size(); j-- > 0; )
+		{
+			if (std::find(ports.begin(), ports.end(), ServerSocket::listeningPort(_listeners[i][j])) != ports.end())
+				continue ;
+			close(_listeners[i][j]);
+			_listeners[i].erase(_listeners[i].begin() + j);
+		}
+	}
+	for (size_t i = 0; i < _pids.size(); i++)
+		if (_pids[i] > 0)
+			kill(_pids[i], SIGHUP);
+	debugger.info("Reloaded the configuration from " + _config.path());
+}
+
+/**
+ * @brief Stops the workers gracefully with signum (SIGTERM, SIGQUIT), they are not restarted anymore.
+ * Our copies of the listening sockets are closed, a worker closes its own ones once it stops accepting.
+ */
+void	Master::stop(int signum)
+{
+	USE_DEBUGGER;
+	if (_stopping)
+		return ;
+	_stopping = true;
+	for (size_t i = 0; i < _listeners.size(); i++)
+		for (size_t j = 0; j < _listeners[i].size(); j++)
+			close(_listeners[i][j]);
+	_listeners.clear();
+	for (size_t i = 0; i < _pids.size(); i++)
+		if (_pids[i] > 0)
+			kill(_pids[i], signum);
+	debugger.info("Stopping, waiting for the workers to finish their requests.");
+}
+
+/**
+ * @brief Starts the new binary on the listening sockets of all workers (SIGUSR2).
+ * The workers keep serving next to the new binary until we are stopped with SIGQUIT.
+ */
+void	Master::upgrade()
+{
+	USE_DEBUGGER;
+	std::vector<int>	fds;
+
+	for (size_t i = 0; i < _listeners.size(); i++)
+		fds.insert(fds.end(), _listeners[i].begin(), _listeners[i].end());
+	pid_t	pid = BinaryUpgrade::getInstance().start(fds);
+	if (pid < 0)
+		debugger.error("Could not start the new binary.");
+	else
+		debugger.info("Started the new binary with pid " + to_str(pid) + ", stop this one with SIGQUIT once it serves.");
+}
+
+/**
+ * @brief Returns true while a worker is running
+ */
+bool	Master::hasWorkers() const
+{
+	for (size_t i = 0; i < _pids.size(); i++)
+		if (_pids[i] > 0)
+			return true;
+	return false;
+}
+
+/**
+ * @brief Starts all the workers and restarts every worker which dies, until the workers were stopped.
+ * The signals are checked every MASTER_INTERVAL milliseconds or as soon as one arrives (self-pipe).
+ * A worker dying right after it was started is restarted with a delay, to not fork in a loop.
+ */
+void	Master::run()
+{
+	USE_DEBUGGER;
+	ControlSignals	&signals = ControlSignals::getInstance();
+
+	signals.install(); // before the fork, a worker never misses a signal
+	for (size_t i = 0; i < _pids.size(); i++)
+		spawnWorker(i);
+	while (!_stopping || hasWorkers())
+	{
+		struct pollfd	control;
+		control.fd = signals.getFd();
+		control.events = POLLIN;
+		control.revents = 0;
+		poll(&control, control.fd >= 0, MASTER_INTERVAL);
+		if (signals.received(SIGHUP) && !_stopping)
+			reload();
+		if (signals.received(SIGUSR2) && !_stopping)
+			upgrade();
+		if (signals.received(SIGTERM))
+			stop(SIGTERM);
+		if (signals.received(SIGQUIT))
+			stop(SIGQUIT);
+		int		status = 0;
+		pid_t	pid;
+		while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+		{
+			int	slot = findWorker(pid);
+			if (slot < 0) // the new binary of an upgrade which stopped
+				continue;
+			_pids[slot] = -1;
+			if (_stopping)
+				continue;
+			debugger.error("Worker " + to_str(slot) + " with pid " + to_str(pid) + " died. Restarting it.");
+			if (std::time(NULL) - _started[slot] < 1)
+				sleep(1);
+			spawnWorker(slot);
+		}
+		if (pid < 0 && errno == ECHILD)
+		{
+			debugger.error("No worker left to wait for.");
+			return ;
+		}
+	}
+	debugger.info("All workers stopped.");
+}
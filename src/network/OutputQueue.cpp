@@ -0,0 +1,182 @@
+#include "../../inc/network/OutputQueue.hpp"
+#include <unistd.h>
+#include <algorithm>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#if defined(__linux__)
+# include <sys/sendfile.h>
+#endif
+
+OutputQueue::OutputQueue() : _size(0)
+{
+}
+
+OutputQueue::~OutputQueue()
+{
+	clear();
+}
+
+/**
+ * @brief Appends data to the output. The content of data is moved into the queue, data is empty afterwards.
+ */
+void	OutputQueue::pushData(std::string &data)
+{
+	if (data.empty())
+		return ;
+	pushShared(SharedBuffer(data));
+}
+
+/**
+ * @brief Appends a buffer which is shared with others (cache, pre-rendered pages), it is not copied.
+ */
+void	OutputQueue::pushShared(const SharedBuffer &data)
+{
+	if (data.empty())
+		return ;
+	OutputSegment	segment;
+	segment.data = data;
+	segment.sent = 0;
+	segment.fd = NO_FILE;
+	segment.offset = 0;
+	segment.length = 0;
+	_segments.push_back(segment);
+	_size += data.size();
+}
+
+/**
+ * @brief Appends length bytes of the file fd starting at offset. The queue takes over the filedescriptor.
+ */
+void	OutputQueue::pushFile(int fd, off_t offset, size_t length)
+{
+	if (!length)
+	{
+		close(fd);
+		return ;
+	}
+	OutputSegment	segment;
+	segment.sent = 0;
+	segment.fd = fd;
+	segment.offset = offset;
+	segment.length = length;
+	_segments.push_back(segment);
+	_size += length;
+}
+
+/**
+ * @brief Sends the file region of segment with a single syscall.
+ * Without sendfile() the region is read into a stack buffer and sent from there.
+ */
+ssize_t	OutputQueue::sendFileRegion(int socket, OutputSegment &segment)
+{
+	ssize_t	bytes;
+
+#if defined(__linux__)
+	bytes = sendfile(socket, segment.fd, &segment.offset, segment.length);
+	if (bytes > 0)
+		segment.length -= bytes;
+#elif defined(__APPLE__)
+	off_t	len = segment.length;
+	if (sendfile(segment.fd, socket, segment.offset, &len, NULL, 0) < 0 && !len)
+		return -1;
+	bytes = len;
+	segment.offset += len;
+	segment.length -= len;
+#else
+	char	buffer[65536];
+	ssize_t	got = pread(segment.fd, buffer, std::min(segment.length, sizeof(buffer)), segment.offset);
+	if (got <= 0)
+		return got;
+	bytes = send(socket, buffer, got, 0);
+	if (bytes > 0)
+	{
+		segment.offset += bytes;
+		segment.length -= bytes;
+	}
+#endif
+	return bytes;
+}
+
+/**
+ * @brief Sends the data segments at the front of the queue (up to the next file region) with one writev call
+ * and drops the segments which were sent completely.
+ */
+ssize_t	OutputQueue::sendDataSegments(int socket)
+{
+	struct iovec	iov[OUTPUT_MAX_IOVEC];
+	int				count = 0;
+
+	for (std::deque<OutputSegment>::iterator it = _segments.begin();
+		it != _segments.end() && (*it).fd == NO_FILE && count < OUTPUT_MAX_IOVEC; ++it, ++count)
+	{
+		iov[count].iov_base = (char*)(*it).data.data() + (*it).sent;
+		iov[count].iov_len = (*it).data.size() - (*it).sent;
+	}
+	ssize_t	bytes = writev(socket, iov, count);
+	if (bytes <= 0)
+		return bytes;
+	size_t	left = bytes;
+	while (left)
+	{
+		OutputSegment	&segment = _segments.front();
+		size_t			rest = segment.data.size() - segment.sent;
+		if (left < rest)
+		{
+			segment.sent += left;
+			break;
+		}
+		left -= rest;
+		popFront();
+	}
+	return bytes;
+}
+
+/**
+ * @brief Sends the front of the queue with a single syscall and drops what was sent completely.
+ * @return the amount of bytes sent, 0 if a file ended early, -1 on error (errno is set, EAGAIN if the socket is full)
+ */
+ssize_t	OutputQueue::sendTo(int socket)
+{
+	if (_segments.empty())
+		return 0;
+	OutputSegment	&segment = _segments.front();
+	ssize_t			bytes;
+
+	if (segment.fd == NO_FILE)
+		bytes = sendDataSegments(socket);
+	else
+	{
+		bytes = sendFileRegion(socket, segment);
+		if (bytes > 0 && !segment.length)
+			popFront();
+	}
+	if (bytes > 0)
+		_size -= bytes;
+	return bytes;
+}
+
+void	OutputQueue::popFront()
+{
+	if (_segments.front().fd != NO_FILE)
+		close(_segments.front().fd);
+	_segments.pop_front();
+}
+
+/**
+ * @brief Drops everything which was not sent yet and closes the files.
+ */
+void	OutputQueue::clear()
+{
+	while (!_segments.empty())
+		popFront();
+	_size = 0;
+}
+
+bool	OutputQueue::empty() const
+{
+	return _segments.empty();
+}
+
+size_t	OutputQueue::size() const
+{
+	return _size;
+}
@@ -0,0 +1,97 @@
+#include "../../inc/network/PollEventLoop.hpp"
+#include <cstddef>
+
+PollEventLoop::PollEventLoop() {}
+
+PollEventLoop::~PollEventLoop() {}
+
+/**
+ * @brief Returns the position of the pollfd which belongs to fd or -1 if it is not registered
+ */
+int	PollEventLoop::find(int fd) const
+{
+	if (fd < 0 || (size_t) fd >= _index.size())
+		return -1;
+	return _index[fd];
+}
+
+/**
+ * @brief Starts watching fd for the given poll events. Adding an already watched fd updates its events.
+ */
+bool	PollEventLoop::add(int fd, short events)
+{
+	if (fd < 0)
+		return false;
+	int	pos = find(fd);
+	if (pos != -1)
+	{
+		_pollfds[pos].events = events;
+		return true;
+	}
+	struct pollfd	tmp;
+	tmp.fd = fd;
+	tmp.events = events;
+	tmp.revents = 0;
+	_pollfds.push_back(tmp);
+	if ((size_t) fd >= _index.size())
+		_index.resize(fd + 1, -1);
+	_index[fd] = _pollfds.size() - 1;
+	return true;
+}
+
+/**
+ * @brief Changes the events we are waiting for on fd
+ */
+bool	PollEventLoop::modify(int fd, short events)
+{
+	int	pos = find(fd);
+	if (pos == -1)
+		return add(fd, events);
+	_pollfds[pos].events = events;
+	return true;
+}
+
+/**
+ * @brief Stops watching fd. Has to be called before the fd gets closed.
+ * The last pollfd takes the place of the removed one.
+ */
+void	PollEventLoop::remove(int fd)
+{
+	int	pos = find(fd);
+	if (pos == -1)
+		return ;
+	_index[fd] = -1;
+	if ((size_t) pos != _pollfds.size() - 1)
+	{
+		_pollfds[pos] = _pollfds.back();
+		_index[_pollfds[pos].fd] = pos;
+	}
+	_pollfds.pop_back();
+}
+
+/**
+ * @brief Waits until at least one fd is ready (or timeout milliseconds passed, -1 to wait forever)
+ * and collects only the ready filedescriptors in ready.
+ * @return the number of ready filedescriptors, -1 on error
+ */
+int	PollEventLoop::wait(std::vector<IoEvent> &ready, int timeout)
+{
+	ready.clear();
+	int	count = poll(_pollfds.data(), _pollfds.size(), timeout);
+	if (count < 1)
+		return count;
+	for (std::vector<pollfd>::iterator it = _pollfds.begin(); it != _pollfds.end() && (int) ready.size() < count; ++it)
+	{
+		if (!(*it).revents)
+			continue;
+		IoEvent	event;
+		event.fd = (*it).fd;
+		event.events = (*it).revents;
+		ready.push_back(event);
+	}
+	return ready.size();
+}
+
+bool	PollEventLoop::isEdgeTriggered() const { return false; }
+
+const char	*PollEventLoop::getName() const { return "poll"; }
@@ -0,0 +1,117 @@
+#include "../../inc/network/ReceiveBuffer.hpp"
+#include <cstring>
+#include <unistd.h>
+
+SlabPool::SlabPool()
+{
+}
+
+SlabPool::~SlabPool()
+{
+	for (size_t i = 0; i < _free.size(); i++)
+		delete[] _free[i];
+}
+
+/**
+ * @brief Returns a slab of RECEIVE_SLAB_SIZE bytes, a free one if there is any
+ */
+char	*SlabPool::acquire()
+{
+	if (_free.empty())
+		return new char[RECEIVE_SLAB_SIZE];
+	char	*slab = _free.back();
+	_free.pop_back();
+	return slab;
+}
+
+void	SlabPool::release(char *slab)
+{
+	if (_free.size() >= RECEIVE_POOL_MAXIMUM_FREE)
+		delete[] slab;
+	else
+		_free.push_back(slab);
+}
+
+ReceiveBuffer::ReceiveBuffer() : _storage(NULL), _capacity(0), _start(0), _end(0)
+{
+}
+
+ReceiveBuffer::~ReceiveBuffer()
+{
+	releaseStorage();
+}
+
+const char	*ReceiveBuffer::data() const	{ return _storage + _start; }
+size_t		ReceiveBuffer::size() const		{ return _end - _start; }
+bool		ReceiveBuffer::empty() const	{ return _end == _start; }
+
+/**
+ * @brief Reads from fd into the free space at the tail
+ * @return the result of read()
+ */
+ssize_t	ReceiveBuffer::readFrom(int fd)
+{
+	reserve();
+	ssize_t	bytes = read(fd, _storage + _end, _capacity - _end);
+	if (bytes > 0)
+		_end += bytes;
+	else if (empty())
+		releaseStorage();
+	return bytes;
+}
+
+/**
+ * @brief Drops size bytes at the front, they were handed to the request
+ */
+void	ReceiveBuffer::consume(size_t size)
+{
+	_start += size;
+	if (_start >= _end)
+		releaseStorage();
+}
+
+/**
+ * @brief Makes sure there is free space at the tail.
+ * The remaining bytes are moved to the front if there is space in front of them, otherwise the storage doubles.
+ */
+void	ReceiveBuffer::reserve()
+{
+	if (!_storage)
+	{
+		_storage = SlabPool::getInstance().acquire();
+		_capacity = RECEIVE_SLAB_SIZE;
+		return ;
+	}
+	if (_end < _capacity)
+		return ;
+	if (_start)
+	{
+		std::memmove(_storage, _storage + _start, _end - _start);
+		_end -= _start;
+		_start = 0;
+		return ;
+	}
+	size_t	capacity = _capacity * 2;
+	size_t	end = _end;
+	char	*storage = new char[capacity];
+	std::memcpy(storage, _storage, end);
+	releaseStorage();
+	_storage = storage;
+	_capacity = capacity;
+	_end = end;
+}
+
+/**
+ * @brief Gives the storage back, slabs to the pool and grown storage to the heap
+ */
+void	ReceiveBuffer::releaseStorage()
+{
+	if (_storage && _capacity == RECEIVE_SLAB_SIZE)
+		SlabPool::getInstance().release(_storage);
+	else
+		delete[] _storage;
+	_storage = NULL;
+	_capacity = 0;
+	_start = 0;
+	_end = 0;
+}
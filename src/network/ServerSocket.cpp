@@ -2,80 +2,306 @@
 #include "../../inc/http/Response.hpp"
 #include "../../inc/http/Process.hpp"
 #include "../../inc/debugger/DebuggerPrinter.hpp"
+#include "../../inc/network/EventLoop.hpp"
 #include <sys/ioctl.h>
+#include <algorithm>
+#include <csignal>
+#include "../../inc/network/ChildSupervisor.hpp"
+#include "../../inc/http/CgiHelperPool.hpp"
+#include "../../inc/network/ControlSignals.hpp"
+#include "../../inc/network/BinaryUpgrade.hpp"
 
 
 /**
- * @brief Setup, bind and put the sockets in listening mode. (Ports of one server Block)
- * @param serverBlock, parsed server config file.
+ * @brief Setup, bind and put the sockets in listening mode. (Ports of all server Blocks)
+ * After a binary upgrade the sockets of the previous binary are taken over, only the other ports are opened.
+ * @param config, the compiled configuration.
  * @param address, network interface where to listen.
- * @param configFile the configuration File
  */
-ServerSocket::ServerSocket(ServerBlock serverBlock, ConfigFileParsing configFile, unsigned int address): _serverBlock(serverBlock), _configFile(configFile)
+ServerSocket::ServerSocket(const ConfigSnapshot &config, unsigned int address): _config(config), _address(address), _reuse_port(false), _loop(NULL), _draining(false), _drain_deadline(0)
 {
-	std::vector<struct sockaddr_in>::iterator	so;
-	std::vector<unsigned int> allPorts = getAllServerPortsFromAllServerBlocks(configFile.serverBlocks);
-	listeningSockets = allPorts.size();
-	_sockets.resize(listeningSockets);
-	int	i = 0;
-	for (so = _sockets.begin(); so != _sockets.end(); so++, i++) //configure the sockets
+	_fds = BinaryUpgrade::getInstance().inheritedSockets();
+	std::vector<int>	opened = openListeningSockets(missingPorts(_config.ports(), _fds), address, false);
+	_fds.insert(_fds.end(), opened.begin(), opened.end());
+	listeningSockets = _fds.size();
+	processConnections();
+}
+
+/**
+ * @brief Serves on listening sockets which were already opened, bound and put in listening mode.
+ * Used by the worker processes, every worker gets its own set of sockets from the Master.
+ * Ports of the configuration without a socket (added by a reload of the master) get one of their own.
+ * @param config, the compiled configuration.
+ * @param address, network interface where to listen.
+ * @param listening_fds, sockets returned by openListeningSockets
+ */
+ServerSocket::ServerSocket(const ConfigSnapshot &config, unsigned int address, std::vector<int> listening_fds): _fds(listening_fds), _config(config), _address(address), _reuse_port(true), _loop(NULL), _draining(false), _drain_deadline(0)
+{
+	listeningSockets = _fds.size();
+	processConnections();
+}
+
+/**
+ * @brief Creates one non blocking listening socket per port.
+ * @param ports, ports to listen on
+ * @param address, network interface where to listen.
+ * @param reuse_port, sets SO_REUSEPORT so several sockets (one per worker) can be bound to the same port
+ * and the kernel load-balances the incoming connections between them.
+ * @return the listening filedescriptors in the same order as ports
+ * @throws SocketCreationError, the sockets opened so far are closed
+ */
+std::vector<int> ServerSocket::openListeningSockets(std::vector<unsigned int> ports, unsigned int address, bool reuse_port)
+{
+	std::vector<int>	fds;
+	const int			enable = 1;
+
+	try {
+		for (size_t i = 0; i < ports.size(); i++)
+		{
+			struct sockaddr_in	so;
+			so.sin_family = AF_INET;
+			so.sin_port = htons(ports[i]);
+			so.sin_addr.s_addr = address;
+			bzero(&(so.sin_zero), 8);
+
+			int fd = socket(AF_INET, SOCK_STREAM, 0); //IPv4, TCP
+			if (fd < 0)
+				throw SocketCreationError();
+			fds.push_back(fd);
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int));
+			if (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(int)))
+				throw SocketCreationError();
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK); // make the fd non blocking
+			fcntl(fd, F_SETFD, FD_CLOEXEC); // a cgi must not inherit the ports
+			if (bind(fd, (struct sockaddr *)&so, sizeof(struct sockaddr_in))) //bind the fd to the socket
+				throw SocketCreationError();
+			if (listen(fd, BACKLOG)) //backlog is the length of the queue for the upcoming connections
+				throw SocketCreationError();
+		}
+	} catch (SocketCreationError &e) {
+		for (size_t i = 0; i < fds.size(); i++)
+			close(fds[i]);
+		throw ;
+	}
+	return fds;
+}
+
+/**
+ * @brief Returns the port a listening socket is bound to, 0 if it is not a socket
+ */
+unsigned int ServerSocket::listeningPort(int fd)
+{
+	struct sockaddr_in	so;
+	socklen_t			size = sizeof(so);
+
+	if (getsockname(fd, (struct sockaddr *)&so, &size) < 0 || so.sin_family != AF_INET)
+		return 0;
+	return ntohs(so.sin_port);
+}
+
+/**
+ * @brief Returns the ports without one of the listening sockets fds
+ */
+std::vector<unsigned int> ServerSocket::missingPorts(const std::vector<unsigned int> &ports, const std::vector<int> &fds)
+{
+	std::vector<unsigned int>	open;
+	std::vector<unsigned int>	missing;
+
+	for (size_t i = 0; i < fds.size(); i++)
+		open.push_back(listeningPort(fds[i]));
+	for (size_t i = 0; i < ports.size(); i++)
+		if (std::find(open.begin(), open.end(), ports[i]) == open.end())
+			missing.push_back(ports[i]);
+	return missing;
+}
+
+/**
+ * @brief Makes the listening sockets match the ports of the configuration.
+ * Sockets of ports which are not used anymore are closed, ports without a socket get a new one.
+ * A port which can not be opened is left out, the others are served anyway.
+ */
+void ServerSocket::syncListeningSockets()
+{
+	USE_DEBUGGER;
+	const std::vector<unsigned int>	&ports = _config.ports();
+
+	for (size_t i = _fds.size(); i-- > 0; )
 	{
-		(*so).sin_family = AF_INET;
-		(*so).sin_port = htons(allPorts[i]);
-		(*so).sin_addr.s_addr = address;
-		bzero(&((*so).sin_zero), 8);
+		unsigned int	port = listeningPort(_fds[i]);
+		if (std::find(ports.begin(), ports.end(), port) != ports.end())
+			continue ;
+		debugger.info("Stopped listening on port " + to_str(port));
+		if (_loop)
+			_loop->remove(_fds[i]);
+		close(_fds[i]);
+		_fds.erase(_fds.begin() + i);
 	}
-	const int	enable = 1;
-	_fds.resize(_sockets.size());
-	std::vector<int>::iterator	fd;
-	for (fd = _fds.begin(); fd != _fds.end(); fd++) //setup the sockets and make the fds non blocking
+	std::vector<unsigned int>	missing = missingPorts(ports, _fds);
+	for (size_t i = 0; i < missing.size(); i++)
 	{
-		(*fd) = socket(AF_INET, SOCK_STREAM, 0); //IPv4, TCP
-		if (*fd < 0)
-			throw SocketCreationError();
-		setsockopt(*fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int));
-		fcntl(*fd, F_SETFL, fcntl(*fd, F_GETFL, 0) | O_NONBLOCK);
+		try {
+			int	fd = openListeningSockets(std::vector<unsigned int>(1, missing[i]), _address, _reuse_port).front();
+			_fds.push_back(fd);
+			if (_loop)
+				_loop->add(fd, POLLIN);
+			debugger.info("Listening on port " + to_str(missing[i]));
+		} catch (SocketCreationError &e) {
+			debugger.error("Could not listen on port " + to_str(missing[i]));
+		}
 	}
+	listeningSockets = _fds.size();
+}
+
+/**
+ * @brief Reads the configuration file again (SIGHUP) and serves the next requests with it.
+ * An invalid file is reported and the current configuration stays. The connections finish the request
+ * they are busy with on the old configuration, which is freed once the last of them moved on.
+ */
+void ServerSocket::reload()
+{
+	USE_DEBUGGER;
+	ConfigSnapshot	config;
+
+	try {
+		config = ConfigSnapshot::load(_config.path());
+	} catch (const std::exception &e) {
+		debugger.error("Could not reload " + _config.path() + ", keeping the current configuration: " + e.what());
+		return ;
+	}
+	_config = config;
+	syncListeningSockets();
+	FileCache::getInstance().configure(_config.fileCacheSize(), _config.fileCacheCheckInterval());
+	for (size_t i = 0; i < _clients.size(); i++)
+		_clients[i].second->reconfigure(_config);
+	debugger.info("Reloaded the configuration from " + _config.path());
+}
+
+/**
+ * @brief Acts on the signals received since the last iteration of the event loop.
+ * The flags are checked after every iteration, a signal arriving while the self-pipe is emptied is not missed.
+ */
+void ServerSocket::handleControlSignals()
+{
+	ControlSignals	&signals = ControlSignals::getInstance();
 
-	for (fd = _fds.begin(), so = _sockets.begin(); fd != _fds.end(); fd++, so++) //bind the fds to the sockets and put them in listening mode
+	if (signals.received(SIGHUP) && !_draining)
+		reload();
+	if (signals.received(SIGUSR2) && !_draining)
+		upgrade();
+	if (signals.received(SIGTERM))
+		drain();
+	if (signals.received(SIGQUIT))
+		drain();
+}
+
+/**
+ * @brief Starts the new binary on our listening sockets (SIGUSR2).
+ * We keep serving next to it until we are stopped with SIGQUIT. A worker leaves the upgrade to its master.
+ */
+void ServerSocket::upgrade()
+{
+	USE_DEBUGGER;
+	if (_reuse_port)
+		return ;
+	pid_t	pid = BinaryUpgrade::getInstance().start(_fds);
+	if (pid < 0)
+		debugger.error("Could not start the new binary.");
+	else
+		debugger.info("Started the new binary with pid " + to_str(pid) + ", stop this one with SIGQUIT once it serves.");
+}
+
+/**
+ * @brief Stops the server gracefully (SIGTERM, SIGQUIT).
+ * The listening sockets are closed right away, connections waiting for their next request are closed.
+ * The other clients finish the request they are busy with and get their connection closed afterwards,
+ * the event loop ends once the last of them is done or SHUTDOWN_TIMEOUT seconds passed.
+ */
+void ServerSocket::drain()
+{
+	USE_DEBUGGER;
+	if (_draining)
+		return ;
+	_draining = true;
+	_drain_deadline = std::time(NULL) + SHUTDOWN_TIMEOUT;
+	for (size_t i = 0; i < _fds.size(); i++)
 	{
-		if (bind(*fd, (struct sockaddr *)&(*so), sizeof(struct sockaddr_in)))
-			throw SocketCreationError();
-		if (listen(*fd, BACKLOG)) //backlog is the length of the queue for the upcoming connections
-			throw SocketCreationError();
+		_loop->remove(_fds[i]);
+		close(_fds[i]);
 	}
-	processConnections();
+	_fds.clear();
+	listeningSockets = 0;
+	for (int pos = _clients.size() - 1; pos >= 0; pos--) // backwards, removing swaps an already checked client in
+	{
+		_clients[pos].second->drain();
+		if (_clients[pos].second->isIdle())
+			disconnectClient(pos);
+	}
+	debugger.info("Stopped accepting connections, " + to_str(_clients.size()) + " clients left to finish.");
+}
+
+ServerSocket::~ServerSocket()
+{
+	for (size_t i = 0; i < _clients.size(); ++i)
+		delete _clients[i].second;
+	delete _loop;
 }
 
-ServerSocket::~ServerSocket(){}
+/**
+ * @brief Points the slot of fd to the client at position pos (grows the table if needed)
+ */
+void ServerSocket::linkClientSlot(int fd, int pos)
+{
+	if (fd < 0)
+		return ;
+	if ((size_t) fd >= _client_slots.size())
+		_client_slots.resize(fd + 1, NO_CLIENT);
+	_client_slots[fd] = pos;
+}
+
+/**
+ * @brief Removes the client at pos by moving the last client into its place.
+ * Only the slot of the moved client has to be updated, nothing else shifts.
+ * A client registered without a filedescriptor (-1) has no slot.
+ */
+void ServerSocket::removeClientSlot(int pos)
+{
+	int	last = _clients.size() - 1;
+
+	if (_clients[pos].first >= 0)
+		_client_slots[_clients[pos].first] = NO_CLIENT;
+	delete _clients[pos].second;
+	if (pos != last)
+	{
+		_clients[pos] = _clients[last];
+		linkClientSlot(_clients[pos].first, pos);
+	}
+	_clients.pop_back();
+}
 
 /**
- * @brief Removes the socket from the vector and closes it.
- * This should be called if the client was not yet created
- * @param pollfds the pollfds
- * @param i index
+ * @brief Returns true if fd is one of our listening sockets (ports)
  */
-void ServerSocket::socketFailed(std::vector<pollfd> &pollfds, int i)
+bool ServerSocket::isListeningSocket(int fd)
 {
-	close(pollfds[i].fd);
-	pollfds.erase(pollfds.begin() + i);
-	std::cout << "Socket closed because it failed." << std::endl;
+	return find_vector(_fds, fd) != -1;
 }
 
 /**
  * @brief Disconnects the given client from the server
- *
- * @param pollfds the pollfds
- * @param i index
+ * Unregisters the filedescriptor the client currently waits on from the event loop and closes the connection.
+ * If the client was busy with the cgi at that moment, the cgi files are closed (and the script killed) by the client.
+ * @param pos position of the client
  */
-void ServerSocket::disconnectClient(std::vector<pollfd> &pollfds, int i)
+void ServerSocket::disconnectClient(int pos)
 {
 	USE_DEBUGGER;
-	client_iter pos = get_CS_position(_clients, pollfds[i].fd);
-	close(pollfds[i].fd);
-	pollfds.erase(pollfds.begin() + i);
-	if (pos != _clients.end())
-		_clients.erase(pos);
+	int	fd = _clients[pos].first;
+	int	client_fd = _clients[pos].second->_client_fd;
+	_loop->remove(fd);
+	if (client_fd != fd)
+		_loop->remove(client_fd);
+	close(client_fd);
+	removeClientSlot(pos);
 	debugger.verbose("Client removed and connection closed.");
 }
 
@@ -83,26 +309,24 @@ void ServerSocket::disconnectClient(std::vector<pollfd> &pollfds, int i)
  * @brief Here we check if the client connection broke. If it does, we make sure to remove it.
  * A connection to a client is being considered broken if the client has an revent of
  * POLLERR, POLLHUP.
- * @param pollfds poll fds
- * @param i index
+ * @param pos position of the client
+ * @param revents events reported by the event loop
  */
-void ServerSocket::checkIfConnectionIsBroken(std::vector<pollfd> &pollfds, int i)
+void ServerSocket::checkIfConnectionIsBroken(int pos, short revents)
 {
-	if (pollfds[i].revents & ((POLLERR | POLLHUP)))
+	if (revents & ((POLLERR | POLLHUP)))
 	{
 		if (ENABLE_LOGGING)
-			std::cout << "Connection broken. Error code: " << pollfds[i].revents << std::endl;
-		disconnectClient(pollfds, i);
+			std::cout << "Connection broken. Error code: " << revents << std::endl;
+		disconnectClient(pos);
 		return ;
 	}
-	if (pollfds[i].revents & POLLNVAL)
+	if (revents & POLLNVAL)
 	{
 		if (ENABLE_LOGGING)
-			std::cout << "Found an invalid connection. Taking care. " << pollfds[i].revents << std::endl;
-		client_iter pos = get_CS_position(_clients, pollfds[i].fd);
-		pollfds.erase(pollfds.begin() + i);
-		if (pos != _clients.end())
-			_clients.erase(pos);
+			std::cout << "Found an invalid connection. Taking care. " << revents << std::endl;
+		_loop->remove(_clients[pos].first);
+		removeClientSlot(pos);
 		return ;
 	}
 }
@@ -110,174 +334,239 @@ void ServerSocket::checkIfConnectionIsBroken(std::vector<pollfd> &pollfds, int i
 /**
  * @brief Here we listen on the ports and accept new incoming connections.
  *
- * @param pollfds the pollfd vector
- * @param i index of the current pollfd
+ * @param listening_fd the listening socket which reported a pending connection
  *
- * @returns false, if a client was declined
+ * @returns false, if there was no connection left to accept.
+ * Declined clients (server full) still return true, because there might be more connections waiting.
  */
-bool ServerSocket::acceptNewConnectionsIfAvailable(std::vector<pollfd> &pollfds, int i) {
+bool ServerSocket::acceptNewConnectionsIfAvailable(int listening_fd) {
 	USE_DEBUGGER;
 
-	struct pollfd tmp;
 	struct sockaddr_in clientSocket;
 	socklen_t socketSize = sizeof(clientSocket);
 
 	int forward;
-	forward = accept(pollfds[i].fd, (struct sockaddr *)&clientSocket, &socketSize);
+	forward = accept(listening_fd, (struct sockaddr *)&clientSocket, &socketSize);
 	if (ENABLE_LOGGING)
 		std::cout << "New connection accepted on fd " << forward << std::endl;
 	if (forward == -1) return false;
-	tmp.fd = forward; // set the newly obtained file descriptor to the pollfd. Important to do this before the fcntl call!
 	int val = fcntl(forward, F_SETFL, fcntl(forward, F_GETFL, 0) | O_NONBLOCK);
+	if (val != -1)
+		val = fcntl(forward, F_SETFD, FD_CLOEXEC); // a cgi (and whatever it starts) must not keep the connection open
 	if (val == -1) { // fcntl failed, we now need to close the socket
 		debugger.verbose("fcntl failed. Closing socket.");
 		close(forward);
-		return false;
+		return true;
 	};
 	if (_clients.size() >= MAXIMUM_CONNECTED_CLIENTS) {
 		debugger.debug( to_string(_clients.size()) + " / 10Maximum number of clients reached. Declining connection.");
-		int result = send_server_unavailable(forward, _serverBlock);
+		int result = send_server_unavailable(forward, _config.defaultServerBlock());
 		if (result < 1) {
 			debugger.verbose("Error while sending 503 to client. Closing connection.");
 			close(forward);
-			return false;
+			return true;
 		}
 		debugger.verbose("Closing connection 3");
 		close(forward);
-		return false;
+		return true;
 	}
 
-	// set the pollfd to listen for POLLIN events (read events)
-	tmp.events = POLLIN;
-	tmp.revents = 0;
-	pollfds.push_back(tmp); //add the new fd/socket to the set, considered as "client"
-	_clients.push_back(std::pair<int, ClientSocket>(forward, ClientSocket(clientSocket, _serverBlock, forward, _configFile))); //Link the forwarded fd to a new client
+	// listen for POLLIN events (read events) on the new client
+	if (!_loop->add(forward, POLLIN))
+	{
+		debugger.verbose("Could not register client in the event loop. Closing socket.");
+		close(forward);
+		return true;
+	}
+	_clients.push_back(std::pair<int, ClientSocket *>(forward, new ClientSocket(clientSocket, _config, forward))); //Link the forwarded fd to a new client
+	linkClientSlot(forward, _clients.size() - 1);
+	_timers.schedule(_clients.back().second->_timer, _clients.back().second->deadline()); // a client which never sends anything times out as well
 	return true;
 }
 
+/**
+ * @brief Executes the next operation of the client.
+ * With an edge triggered event loop we will not be notified again for data that is already waiting,
+ * so we keep going until the client either would block, changes the filedescriptor it waits on or is done.
+ * A client switching between reading and writing on its socket continues right away (e.g. sends the response
+ * of the request it just read), the event loop is only asked again once the operation would block.
+ */
+void ServerSocket::dispatchClient(int pos)
+{
+	ClientSocket	&client = *_clients[pos].second;
+	int				fd = client._fd;
+	short			event = client._event;
+
+	while (1) {
+		client._would_block = false;
+		client.call_func_ptr(); //execute the next operation on the fd
+		if (client._remove || client._would_block || client._fd != fd)
+			return ;
+		if (!_loop->isEdgeTriggered() && client._event == event) // level triggered, we get notified again
+			return ;
+		event = client._event;
+	}
+}
 
 /**
- * @brief Handles connections by using POLL
- * and checking if the fds are rdy for I/O operations
- * - first prepares the socket port listeners for polling
+ * @brief Tells the event loop on which filedescriptor and for which event the client waits next, and until when.
+ * The client switches between its socket and the cgi files, the previous fd is unregistered then.
+ */
+void ServerSocket::updateClientInterest(int pos)
+{
+	ClientSocket	&client = *_clients[pos].second;
+	_timers.schedule(client._timer, client.deadline());
+	if (_clients[pos].first != client._fd)
+	{
+		_loop->remove(_clients[pos].first);
+		_loop->add(client._fd, client._event);
+		_client_slots[_clients[pos].first] = NO_CLIENT;
+		_clients[pos].first = client._fd;
+		linkClientSlot(client._fd, pos);
+	}
+	else
+		_loop->modify(client._fd, client._event);
+}
+
+
+/**
+ * @brief Acts on the clients whose deadline passed: they are disconnected or their cgi is stopped.
+ * The timer of a client is scheduled every time it changes what it waits for, so only expired clients are visited.
+ * Cgi scripts which keep running after their client was done with them are killed here as well, once per second.
+ */
+void ServerSocket::expireTimers()
+{
+	USE_DEBUGGER;
+	std::time_t	now = std::time(NULL);
+
+	_timers.advance(TimerWheel::now(), _expired);
+	for (size_t i = 0; i < _expired.size(); i++)
+	{
+		ClientSocket	*client = static_cast<ClientSocket *>(_expired[i]->owner());
+		int				pos = get_CS_position(client->_fd);
+		if (pos == NO_CLIENT || _clients[pos].second != client)
+			continue;
+		client->expire();
+		if (client->_remove)
+		{
+			debugger.verbose("Client timed out.");
+			disconnectClient(pos);
+		}
+		else
+			updateClientInterest(pos);
+	}
+	if (now == _last_sweep)
+		return ;
+	_last_sweep = now;
+	ChildSupervisor::getInstance().expire(now);
+}
+
+/**
+ * @brief Returns the milliseconds the event loop may wait: until the next deadline of a client, -1 if there is none.
+ * While cgi scripts run (they may have to be killed) or the server drains, it wakes up every SWEEP_INTERVAL at least.
+ */
+int ServerSocket::nextTimeout()
+{
+	int	timeout = _timers.timeout(TimerWheel::now());
+
+	if ((_draining || ChildSupervisor::getInstance().hasChildren()) && (timeout < 0 || timeout > SWEEP_INTERVAL))
+		return SWEEP_INTERVAL;
+	return timeout;
+}
+
+/**
+ * @brief Handles connections by using the event loop (epoll or poll)
+ * and dispatching only the fds which are rdy for I/O operations
+ * - first registers the socket port listeners in the event loop
  *  - then await new clients on the ports and accepts them
  */
 void ServerSocket::processConnections()
 {
 	USE_DEBUGGER;
-	std::vector<unsigned int> allPorts = getAllServerPortsFromAllServerBlocks(_configFile.serverBlocks);
-
-	// std::vector<pollfd> pollfds;
-	// std::vector<pollfd> pollfds = new std::vector<pollfd>;
-	std::vector<pollfd> *pollfds = new std::vector<pollfd>;
-	(*pollfds).resize(allPorts.size()); //create a vector of pollfds struct, same length as the number of listening sockets
-	std::vector<int>::iterator	it = _fds.begin();
-	std::vector<int>::iterator	ite = _fds.end();
+	std::vector<IoEvent>	ready;
 
+	signal(SIGPIPE, SIG_IGN); // a client closing its persistent connection while we send must not kill the server
+	_last_sweep = std::time(NULL);
+	syncListeningSockets();
+	FileCache::getInstance().configure(_config.fileCacheSize(), _config.fileCacheCheckInterval());
+	CgiHelperPool::getInstance().start(_config.serverBlocks(), _fds); // forks, so before the loop and any connection exists
+	_loop = EventLoop::create();
 	//setup the expected event for the listening sockets to "read"
-	for (unsigned int i = 0; it != ite; ++it, ++i)
-	{
-		(*pollfds)[i].fd = *it;
-		(*pollfds)[i].events = POLLIN;
-		(*pollfds)[i].revents = 0;
-	}
+	for (std::vector<int>::iterator it = _fds.begin(); it != _fds.end(); ++it)
+		_loop->add(*it, POLLIN);
+	if (ChildSupervisor::getInstance().install()) // exited cgis wake us up through the self-pipe
+		_loop->add(ChildSupervisor::getInstance().getFd(), POLLIN);
+	if (ControlSignals::getInstance().install()) // SIGHUP, SIGTERM, SIGQUIT and SIGUSR2 wake us up through the self-pipe
+		_loop->add(ControlSignals::getInstance().getFd(), POLLIN);
 
-	// TODO:
-	// Remove the unreadable function pointers.
-	// See, when the response is actually being sent
-	// Main routine. This will be called the whole time the server runs
-	while (1) {
+	// Main routine. This will be called until the server was stopped and the last client is done (or SHUTDOWN_TIMEOUT passed)
+	while (!_draining || (!_clients.empty() && std::time(NULL) < _drain_deadline)) {
 		if (ENABLE_LOGGING)
-		{
-			std::cout << "filedescriptors: " << (*pollfds).size() << std::endl;
 			std::cout << "clients: " << _clients.size() << std::endl;
-		}
-		if (poll((struct pollfd *)((*pollfds).data()), (*pollfds).size(), -1) < 1) // Here we wait for poll information.
+		if (_loop->wait(ready, nextTimeout()) < 0) // Here we wait for the ready filedescriptors (or the next deadline).
 		{
-			std::cout << "An error occured when polling.";
+			if (errno != EINTR) // a control signal interrupts the wait, it is handled below
+				std::cout << "An error occured when polling.";
 		}
-		for (unsigned long i = 0; i < (*pollfds).size(); ++i) //iterate through the entire area of sockets
+		for (std::vector<IoEvent>::iterator ev = ready.begin(); ev != ready.end(); ++ev) //iterate only through the ready sockets
 		{
-			// print out amount of clients
 			/**
 			 * Listen to the listening sockets for new connections (ports)
 			 */
-			if (i < listeningSockets)
+			if ((*ev).fd == ChildSupervisor::getInstance().getFd())
+			{
+				ChildSupervisor::getInstance().reap();
+				continue;
+			}
+			if ((*ev).fd == ControlSignals::getInstance().getFd()) // handled after the events, see handleControlSignals
+				continue;
+			if (isListeningSocket((*ev).fd))
 			{
-				if ((*pollfds)[i].revents == POLLIN)
-					if (!acceptNewConnectionsIfAvailable((*pollfds), i))
-						continue;
+				if ((*ev).events & POLLIN)
+					while (acceptNewConnectionsIfAvailable((*ev).fd) && _loop->isEdgeTriggered())
+						;
+				continue;
 			}
 			/**
 			 * Listen to established connections
 			 */
-			else //area of ClientSocket, sockets that are the result of a forwarded fd (accepted connection), and that we consider as client.
+			int	pos = get_CS_position((*ev).fd); //retrieve the right client
+			if (pos == NO_CLIENT) // the client was already removed during this iteration
+				continue;
+			if ((*ev).events & (POLLERR | POLLHUP) && (*ev).fd != _clients[pos].second->_client_fd)
+				(*ev).events |= _clients[pos].second->_event; // the cgi closed its output (or the FastCGI server the connection), the next operation finds out
+			else if ((*ev).events & (POLLERR | POLLHUP | POLLNVAL))
 			{
-				client_iter	pos;
-				pos = get_CS_position(_clients, (*pollfds)[i].fd); //retrieve the right client
-				if ((*pollfds)[i].revents == POLLIN) //Client is ready for reading, so we try to read the entire request.
-				{
-					(*pos).second.call_func_ptr(); //execute the next operation on the fd
-					if ((*pos).second.Timeout()) //if the client timeouts, remove it from the list.
-					{
-						debugger.verbose("Client timed out.");
-						disconnectClient((*pollfds), i);
-						continue;
-					}
-					if ((*pos).second._remove) // If a client asks to be removed, remove it from the list
-					{
-						debugger.error("Client asked to be removed. 1");
-						disconnectClient((*pollfds), i);
-						continue;
-					}
-					else
-					{
-						(*pollfds)[i].events = (*pos).second._event;
-						(*pollfds)[i].fd = (*pos).second._fd;
-						(*pos).first = (*pos).second._fd;
-					}
-				}
-			 	else if ((*pollfds)[i].revents == POLLOUT)
-				{
-					(*pos).second.call_func_ptr(); //execute the next operation on the fd
-					//std::cout << "------- START " << std::endl;
-					//std::cout << "Client will now write to file descriptor: " << (*pos).second._fd << std::endl;
-					//std::cout << "Client will now image path: " << (*pos).second._clientRequest.getScript().first << std::endl;
-					//std::cout << "------- END " << std::endl;
-					if ((*pos).second._remove) // The client asks to be removed
-					{
-						debugger.verbose("Client asked to be removed. 2");
-						disconnectClient((*pollfds), i);
-						continue;
-					}
-					else
-					{
-						(*pollfds)[i].events = (*pos).second._event;
-						(*pollfds)[i].fd = (*pos).second._fd;
-						(*pos).first = (*pos).second._fd;
-					}
-				}
-				else
-				{
-					checkIfConnectionIsBroken((*pollfds), i);
-					continue;
-				}
+				checkIfConnectionIsBroken(pos, (*ev).events);
+				continue;
 			}
+			if (!((*ev).events & _clients[pos].second->_event)) // not the event the client is waiting for
+				continue;
+			dispatchClient(pos);
+			if (_clients[pos].second->_remove) // If a client asks to be removed, remove it from the list
+			{
+				debugger.verbose("Client asked to be removed.");
+				disconnectClient(pos);
+				continue;
+			}
+			updateClientInterest(pos);
 		}
+		expireTimers();
+		handleControlSignals();
 	}
+	if (!_clients.empty())
+		debugger.info("Closing " + to_str(_clients.size()) + " connections which did not finish in time.");
+	while (!_clients.empty())
+		disconnectClient(_clients.size() - 1);
+	debugger.info("Server stopped.");
 }
 
 /**
- * @brief Returns the right pair of fd/client corresponding to a fd
+ * @brief Returns the position of the client waiting on fd in _clients or NO_CLIENT
  */
-client_iter	ServerSocket::get_CS_position(std::vector<std::pair<int, ClientSocket> > &vector, int key)
+int	ServerSocket::get_CS_position(int fd)
 {
-	client_iter	it;
-	client_iter ite	= vector.end();
-	for (it = vector.begin(); it < ite; it++)
-	{
-		if ((*it).first == key)
-			return it;
-	}
-	return ite;
+	if (fd < 0 || (size_t) fd >= _client_slots.size())
+		return NO_CLIENT;
+	return _client_slots[fd];
 }
@@ -0,0 +1,195 @@
+#include "../../inc/network/TimerWheel.hpp"
+#include <climits>
+#include <ctime>
+
+Timer::Timer(void *owner) : _owner(owner), _wheel(NULL), _prev(NULL), _next(NULL), _deadline(0), _level(0), _slot(0)
+{
+}
+
+Timer::~Timer()
+{
+	if (_wheel)
+		_wheel->cancel(*this);
+}
+
+bool			Timer::isScheduled() const	{ return _wheel != NULL; }
+unsigned long	Timer::deadline() const		{ return _deadline; }
+void			*Timer::owner() const		{ return _owner; }
+
+TimerWheel::TimerWheel() : _current(now() / TIMER_TICK), _size(0)
+{
+	for (int level = 0; level < TIMER_LEVELS; level++)
+		for (int slot = 0; slot < TIMER_SLOTS; slot++)
+			_slots[level][slot] = NULL;
+}
+
+/**
+ * @brief The timers which are still scheduled are detached, they must not point to the wheel anymore
+ */
+TimerWheel::~TimerWheel()
+{
+	for (int level = 0; level < TIMER_LEVELS; level++)
+		for (int slot = 0; slot < TIMER_SLOTS; slot++)
+			for (Timer *timer = _slots[level][slot]; timer; timer = timer->_next)
+				timer->_wheel = NULL;
+}
+
+/**
+ * @brief Milliseconds of the monotonic clock, setting the time of the system does not move the deadlines
+ */
+unsigned long	TimerWheel::now()
+{
+	struct timespec	time;
+
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (unsigned long)time.tv_sec * 1000 + time.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Schedules the timer for deadline (milliseconds on the now() clock), a scheduled timer is moved.
+ * The timer expires with the first advance() at or after its deadline, never before.
+ */
+void	TimerWheel::schedule(Timer &timer, unsigned long deadline)
+{
+	if (timer._wheel && timer._wheel != this)
+		timer._wheel->cancel(timer);
+	if (timer._wheel)
+		cancel(timer);
+	timer._deadline = deadline;
+	timer._wheel = this;
+	_size++;
+	link(timer, (deadline + TIMER_TICK - 1) / TIMER_TICK);
+}
+
+/**
+ * @brief Removes the timer from the wheel, nothing happens if it is not scheduled
+ */
+void	TimerWheel::cancel(Timer &timer)
+{
+	if (timer._wheel != this)
+		return ;
+	if (timer._prev)
+		timer._prev->_next = timer._next;
+	else
+		_slots[timer._level][timer._slot] = timer._next;
+	if (timer._next)
+		timer._next->_prev = timer._prev;
+	timer._prev = NULL;
+	timer._next = NULL;
+	timer._wheel = NULL;
+	_size--;
+}
+
+/**
+ * @brief Puts the timer into the slot of tick, in the lowest level covering the distance to the current tick.
+ * A deadline behind the range of the wheel waits in the last slot of the highest level and is linked again from there.
+ */
+void	TimerWheel::link(Timer &timer, unsigned long tick)
+{
+	int	level = 0;
+
+	if (tick < _current)
+		tick = _current;
+	while (level < TIMER_LEVELS - 1 && tick - _current >= (1UL << (TIMER_SLOT_BITS * (level + 1))))
+		level++;
+	if (tick - _current >= (1UL << (TIMER_SLOT_BITS * TIMER_LEVELS)))
+		tick = _current + (1UL << (TIMER_SLOT_BITS * TIMER_LEVELS)) - 1;
+	timer._level = level;
+	timer._slot = (tick >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1);
+	timer._prev = NULL;
+	timer._next = _slots[level][timer._slot];
+	if (timer._next)
+		timer._next->_prev = &timer;
+	_slots[level][timer._slot] = &timer;
+}
+
+/**
+ * @brief Distributes the timers of the current slot of level over the levels below
+ */
+void	TimerWheel::cascade(int level)
+{
+	int		slot = (_current >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1);
+	Timer	*timer = _slots[level][slot];
+
+	_slots[level][slot] = NULL;
+	while (timer)
+	{
+		Timer	*next = timer->_next;
+		link(*timer, (timer->_deadline + TIMER_TICK - 1) / TIMER_TICK);
+		timer = next;
+	}
+}
+
+/**
+ * @brief Expires every timer whose deadline is not after now.
+ * @param expired gets the expired timers, they are not scheduled anymore and may be scheduled again right away
+ */
+void	TimerWheel::advance(unsigned long now, std::vector<Timer *> &expired)
+{
+	unsigned long	target = now / TIMER_TICK;
+
+	expired.clear();
+	if (!_size) // nothing to cascade or expire on the way
+	{
+		if (_current <= target)
+			_current = target + 1;
+		return ;
+	}
+	while (_current <= target)
+	{
+		int	slot = _current & (TIMER_SLOTS - 1);
+		for (int level = 1; !slot && level < TIMER_LEVELS; level++) // the level below wrapped around
+		{
+			cascade(level);
+			if ((_current >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1))
+				break ;
+		}
+		while (_slots[0][slot])
+		{
+			Timer	*timer = _slots[0][slot];
+			cancel(*timer);
+			expired.push_back(timer);
+		}
+		_current++;
+	}
+}
+
+/**
+ * @brief Returns the milliseconds the event loop may wait until advance() has something to do, -1 without timers.
+ * That is the first used slot of the lowest level or the next cascade of a used slot of a higher level, whichever comes first.
+ */
+int		TimerWheel::timeout(unsigned long now) const
+{
+	unsigned long	next = ULONG_MAX;
+
+	if (!_size)
+		return -1;
+	for (unsigned long tick = _current; tick < _current + TIMER_SLOTS; tick++)
+	{
+		if (_slots[0][tick & (TIMER_SLOTS - 1)])
+		{
+			next = tick;
+			break ;
+		}
+	}
+	for (int level = 1; level < TIMER_LEVELS; level++) // a timer of a higher level may be due before the ones below
+	{
+		int				shift = TIMER_SLOT_BITS * level;
+		unsigned long	base = _current >> shift;
+		for (unsigned long i = base; i <= base + TIMER_SLOTS; i++) // the cascade of the slot of base may be behind us already
+		{
+			if ((i << shift) < _current || !_slots[level][i & (TIMER_SLOTS - 1)])
+				continue ;
+			if ((i << shift) < next)
+				next = i << shift;
+			break ;
+		}
+	}
+	if (next == ULONG_MAX || next * TIMER_TICK <= now)
+		return 0;
+	if (next * TIMER_TICK - now > INT_MAX)
+		return INT_MAX;
+	return next * TIMER_TICK - now;
+}
+
+size_t	TimerWheel::size() const	{ return _size; }
@@ -50,6 +50,30 @@ std::string convert_configuration_key_type(ConfigurationKeyType keyType)
 	if (keyType == POST_MAX_SIZE) {
 		return "POST MAX SIZE";
 	}
+	if (keyType == WORKER_PROCESSES) {
+		return "WORKER PROCESSES";
+	}
+	if (keyType == KEEPALIVE_TIMEOUT) {
+		return "KEEPALIVE TIMEOUT";
+	}
+	if (keyType == KEEPALIVE_REQUESTS) {
+		return "KEEPALIVE REQUESTS";
+	}
+	if (keyType == CLIENT_HEADER_TIMEOUT) {
+		return "CLIENT HEADER TIMEOUT";
+	}
+	if (keyType == CLIENT_BODY_TIMEOUT) {
+		return "CLIENT BODY TIMEOUT";
+	}
+	if (keyType == SEND_TIMEOUT) {
+		return "SEND TIMEOUT";
+	}
+	if (keyType == FILE_CACHE_SIZE) {
+		return "FILE CACHE SIZE";
+	}
+	if (keyType == FILE_CACHE_CHECK_INTERVAL) {
+		return "FILE CACHE CHECK INTERVAL";
+	}
 	return "UNKNOWN";
 }
 
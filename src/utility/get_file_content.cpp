@@ -15,22 +15,6 @@ std::string get_file_content(std::string path)
 	return content;
 }
 
-/**
- * @brief Get the file content. Caches the file content, if it was already read.
- * 
- * @param path 
- * @return std::string 
- */
-std::string get_file_content_cached(std::string path)
-{
-	static std::map<std::string, std::string> file_content_cache;
-
-	if (file_content_cache.find(path) == file_content_cache.end()) {
-		file_content_cache[path] = get_file_content(path);
-	}
-	return file_content_cache[path];
-}
-
 // int	main(int argc, char**argv)
 // {
 // 	(void)argc;
@@ -15,22 +15,17 @@
  * @param fd filedescriptor
  * @param serverblock so that we can receive the error page file
 */
-int send_server_unavailable(int forward, ServerBlock serverblock)
+int send_server_unavailable(int forward, const ServerBlock &serverblock)
 {
 	std::cout << "--------Unavailable---------" << std::endl;
-	Response response;
-	response.set_status_code(Service_Unavailable);
-	response.set_protocol("HTTP/1.1");
-	response.set_body("Service Unavailable");
-	response.set_body(get_file_content_cached(serverblock.getErrorPagePathForCode(500)));
-	response.set_server("mostlyharmless2.com");
-	response.set_content_type("text/html");
-	response.set_content_length(to_str(response.get_body().length()));
-	response.create_response();
-	if (is_valid_fd(forward))
+	if (!is_valid_fd(forward))
+		return -1;
+	SharedBuffer page = serverblock.getErrorResponse(503, false);
+	if (page.empty()) // the error pages of the server block were not rendered yet
 	{
-		int result = send(forward, response.get_response().data(), response.get_body().length(), 0);
-		return result;
+		ServerBlock rendered(serverblock);
+		rendered.renderErrorPages();
+		page = rendered.getErrorResponse(503, false);
 	}
-	return -1;
-}
\ No newline at end of file
+	return send(forward, page.data(), page.size(), 0);
+}